@@ -0,0 +1,49 @@
+//
+// Created by NEzyaka on 17.10.26.
+//
+
+#include "arena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+
+using namespace turnip2;
+
+Arena::~Arena() {
+    for (auto finalizer = finalizers.rbegin(); finalizer != finalizers.rend(); ++finalizer) {
+        finalizer->second(finalizer->first);
+    }
+}
+
+void *Arena::allocate(std::size_t size, std::size_t align) {
+    auto address = reinterpret_cast<std::uintptr_t>(next);
+    std::size_t padding = (align - address % align) % align;
+
+    if (next == nullptr || static_cast<std::size_t>(limit - next) < padding + size) {
+        std::size_t capacity = std::max(block_size, size + align); // oversized objects get a block of their own
+        blocks.emplace_back(new char[capacity]);
+        next = blocks.back().get();
+        limit = next + capacity;
+
+        address = reinterpret_cast<std::uintptr_t>(next);
+        padding = (align - address % align) % align;
+    }
+
+    void *p = next + padding;
+    next += padding + size;
+    used += padding + size;
+    return p;
+}
+
+void Arena::adopt(Arena &other) {
+    std::move(std::begin(other.blocks), std::end(other.blocks), std::back_inserter(blocks));
+    finalizers.insert(std::end(finalizers), std::begin(other.finalizers), std::end(other.finalizers));
+    used += other.used;
+
+    other.blocks.clear();
+    other.finalizers.clear();
+    other.next = nullptr;
+    other.limit = nullptr;
+    other.used = 0;
+}
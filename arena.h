@@ -0,0 +1,69 @@
+//
+// Created by NEzyaka on 17.10.26.
+//
+
+#ifndef TURNIP2_ARENA_H
+#define TURNIP2_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace turnip2 {
+    // Bump-pointer allocator owning every AST node of one compilation. Nodes
+    // are never freed one by one, the whole tree goes with the arena.
+    class Arena {
+        std::vector<std::unique_ptr<char[]>> blocks;
+        char *next = nullptr;
+        char *limit = nullptr;
+        std::size_t block_size;
+        std::size_t used = 0;
+
+        // objects that need their destructor run, in allocation order
+        std::vector<std::pair<void *, void (*)(void *)>> finalizers;
+
+        void *allocate(std::size_t size, std::size_t align);
+
+    public:
+        explicit Arena(std::size_t block = 1 << 16) : block_size(block) {}
+        ~Arena();
+
+        Arena(const Arena &) = delete;
+        Arena &operator=(const Arena &) = delete;
+
+        template <typename T, typename... Args>
+        T *make(Args &&... args) {
+            T *object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+            if (!std::is_trivially_destructible<T>::value) {
+                finalizers.emplace_back(object, [](void *p) { static_cast<T *>(p)->~T(); });
+            }
+            return object;
+        }
+
+        // trivially copyable items, e.g. the arguments of a call collected in a vector
+        template <typename T>
+        T *copy(const T *items, std::size_t n) {
+            static_assert(std::is_trivially_copyable<T>::value, "arena arrays are copied bytewise");
+            auto *to = static_cast<T *>(allocate(sizeof(T) * n, alignof(T)));
+            std::copy(items, items + n, to);
+            return to;
+        }
+
+        std::string_view copy(std::string_view text) {
+            return {copy(text.data(), text.size()), text.size()};
+        }
+
+        std::size_t bytes() const { return used; } // handed out so far, padding included
+
+        // takes over everything 'other' allocated, which is left empty
+        void adopt(Arena &other);
+    };
+}
+
+
+#endif //TURNIP2_ARENA_H
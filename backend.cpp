@@ -0,0 +1,193 @@
+//
+// Created by NEzyaka on 17.10.26.
+//
+
+#include "backend.h"
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/MC/MCSubtargetInfo.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Transforms/Utils/Mem2Reg.h"
+
+#include <algorithm>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char **environ;
+#endif
+
+Processor hostProcessor() {
+    Processor host;
+    host.cpu = sys::getHostCPUName().str();
+
+    StringMap<bool> detected;
+    if (sys::getHostCPUFeatures(detected)) {
+        std::vector<std::string> features; // sorted, for the same objects from the same machine
+        for (auto &&feature : detected) {
+            features.push_back((feature.getValue() ? "+" : "-") + feature.getKey().str());
+        }
+        std::sort(std::begin(features), std::end(features));
+
+        for (auto &&feature : features) {
+            host.features += (host.features.empty() ? "" : ",") + feature;
+        }
+    }
+
+    return host;
+}
+
+std::unique_ptr<TargetMachine> createTargetMachine(optimization_level level, const Processor &processor, std::string &error) {
+    auto targetTriple = sys::getDefaultTargetTriple();
+    auto target = TargetRegistry::lookupTarget(targetTriple, error);
+
+    if (target == nullptr) {
+        return nullptr;
+    }
+
+    auto CPU = processor.cpu;
+    auto features = processor.features;
+
+    // -O0 is for compiling fast: FastISel and the fast register allocator
+    const CodeGenOpt::Level codegen[] = {CodeGenOpt::None, CodeGenOpt::Less, CodeGenOpt::Default, CodeGenOpt::Aggressive, CodeGenOpt::Default};
+
+    TargetOptions opt;
+    opt.EnableFastISel = level == O0;
+    auto RM = Optional<Reloc::Model>(Reloc::PIC_); // gcc links position-independent executables
+    std::unique_ptr<TargetMachine> machine(
+            target->createTargetMachine(targetTriple, CPU, features, opt, RM, Optional<CodeModel::Model>(), codegen[level])
+    );
+
+    // LLVM would make code for a processor it does not know as for the oldest one
+    if (!machine->getMCSubtargetInfo()->isCPUStringValid(CPU)) {
+        error = "Unknown processor: " + CPU;
+        return nullptr;
+    }
+    return machine;
+}
+
+void optimizeModule(Module *m, TargetMachine *machine, optimization_level level, bool whole_program) {
+    for (auto &&func : *m) { // what the vectorizers, cost models and code generator ask the processor of
+        if (!func.isDeclaration()) {
+            func.addFnAttr("target-cpu", machine->getTargetCPU());
+            if (!machine->getTargetFeatureString().empty()) {
+                func.addFnAttr("target-features", machine->getTargetFeatureString());
+            }
+        }
+    }
+
+    if (level == O0) {
+        // Only the variables become registers, which is cheap and leaves
+        // instruction selection and register allocation far less to do.
+        // With debug info they stay in memory, where a debugger finds them.
+        if (m->getNamedMetadata("llvm.dbg.cu") == nullptr) {
+            FunctionAnalysisManager functions;
+            PassBuilder(machine).registerFunctionAnalyses(functions);
+
+            FunctionPassManager promote;
+            promote.addPass(PromotePass());
+            for (auto &&func : *m) {
+                if (!func.isDeclaration()) {
+                    promote.run(func, functions);
+                }
+            }
+        }
+        return;
+    }
+
+    if (whole_program) {
+        for (auto &&func : *m) {
+            if (!func.isDeclaration() && func.getName() != "main") {
+                func.setLinkage(GlobalValue::InternalLinkage);
+            }
+        }
+    }
+
+    const OptimizationLevel levels[] = {
+            OptimizationLevel::O0,
+            OptimizationLevel::O1,
+            OptimizationLevel::O2,
+            OptimizationLevel::O3,
+            OptimizationLevel::Os
+    };
+
+    PipelineTuningOptions tuning; // vectorize as clang does
+    tuning.LoopVectorization = level >= O2;
+    tuning.SLPVectorization = level >= O2;
+
+    LoopAnalysisManager loops;
+    FunctionAnalysisManager functions;
+    CGSCCAnalysisManager sccs;
+    ModuleAnalysisManager modules;
+
+    PassBuilder builder(machine, tuning);
+    builder.registerModuleAnalyses(modules);
+    builder.registerCGSCCAnalyses(sccs);
+    builder.registerFunctionAnalyses(functions);
+    builder.registerLoopAnalyses(loops);
+    builder.crossRegisterProxies(loops, functions, sccs, modules);
+
+    ModulePassManager passes = builder.buildPerModuleDefaultPipeline(levels[level]);
+    passes.run(*m, modules);
+}
+
+std::string generateObject(Module *m, TargetMachine *machine, const std::string &object) {
+    std::error_code EC;
+    raw_fd_ostream dest(object, EC, sys::fs::OF_None);
+
+    if (EC) {
+        return "Could not open file: " + EC.message();
+    }
+
+    legacy::PassManager pass;
+    auto fileType = CGFT_ObjectFile;
+
+    if (machine->addPassesToEmitFile(pass, dest, nullptr, fileType)) {
+        return "Couldn't emit a file of this type";
+    }
+
+    pass.run(*m);
+    dest.flush();
+    return "";
+}
+
+std::string link(const std::vector<std::string> &objects, const std::string &out) {
+#if defined(__linux__)
+    const std::string failed = "Could not link " + out + ": ";
+
+    std::string output = "-o" + out;
+    std::vector<char *> args{const_cast<char *>("/usr/bin/gcc")};
+    for (auto &&object : objects) {
+        args.push_back(const_cast<char *>(object.c_str()));
+    }
+    args.push_back(const_cast<char *>(output.c_str()));
+    args.push_back(nullptr);
+
+    // unlike fork() and execv(), posix_spawn() tells the caller why gcc could not be run
+    pid_t linker;
+    if (int error = posix_spawn(&linker, "/usr/bin/gcc", nullptr, nullptr, args.data(), environ)) {
+        return failed + "cannot run /usr/bin/gcc: " + std::strerror(error);
+    }
+
+    int status = 0;
+    if (waitpid(linker, &status, 0) != linker) {
+        return failed + "cannot wait for /usr/bin/gcc: " + std::strerror(errno);
+    }
+    if (WIFSIGNALED(status)) {
+        return failed + "/usr/bin/gcc was killed by signal " + std::to_string(WTERMSIG(status)) + " (" + strsignal(WTERMSIG(status)) + ")";
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return failed + "/usr/bin/gcc exited with status " + std::to_string(WEXITSTATUS(status));
+    }
+    return "";
+#else
+    return "";
+#endif
+}
@@ -0,0 +1,63 @@
+//
+// Created by NEzyaka on 17.10.26.
+//
+
+#ifndef TURNIP2_BACKEND_H
+#define TURNIP2_BACKEND_H
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <llvm/IR/Module.h>
+#include <llvm/Target/TargetMachine.h>
+
+using namespace llvm;
+
+// What becomes of the modules of a program once they are generated. Each
+// is optimized for, and written by, a target machine of its own, so that
+// the modules of a ParallelGenerator may be handled on a thread each; the
+// objects are then linked into the program.
+enum optimization_level { O0, O1, O2, O3, Os };
+
+// the processor code is made for, and the features of it to use or not, as "+avx2,-fma"
+struct Processor {
+    std::string cpu = "generic";
+    std::string features;
+};
+
+Processor hostProcessor(); // this machine's, with every feature it has
+
+// the machine a module is optimized for and written by; nullptr and
+// 'error' when there is none for the host or it does not know the processor
+std::unique_ptr<TargetMachine> createTargetMachine(optimization_level level, const Processor &processor, std::string &error);
+
+// LLVM's standard pipeline for 'level' over the whole module, with the cost
+// models of 'machine', whose processor every function is marked with. A
+// program that is a single module has its functions but main made internal,
+// for the interprocedural passes to inline, drop and specialize them;
+// otherwise the other modules may call any of them.
+void optimizeModule(Module *m, TargetMachine *machine, optimization_level level, bool whole_program);
+
+// writes 'm', made for 'machine', to the object file 'object'; the error if any
+std::string generateObject(Module *m, TargetMachine *machine, const std::string &object);
+
+// the object files of every module, linked into 'out' by the system's
+// compiler; the error if any: gcc could not be run, or it failed
+std::string link(const std::vector<std::string> &objects, const std::string &out);
+
+// body(i) for each of 'count' modules, every one on a thread of its own
+template <typename F>
+void forEachModule(std::size_t count, F &&body) {
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i != count; i++) {
+        workers.emplace_back(body, i);
+    }
+    for (auto &&worker : workers) {
+        worker.join();
+    }
+}
+
+
+#endif //TURNIP2_BACKEND_H
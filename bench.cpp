@@ -0,0 +1,488 @@
+//
+// Created by NEzyaka on 17.10.26.
+//
+
+#include "lexer.h"
+#include "parser.h"
+#include "incremental.h"
+#include "cache.h"
+#include "resolver.h"
+#include "generator.h"
+#include "backend.h"
+#include "synth.h"
+
+#include "llvm/Support/TargetSelect.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#include <sys/resource.h>
+#endif
+
+namespace {
+    // Blocks are flat, but the parser and the generator still recurse once
+    // per nesting level and per operator of a long expression, so -depth
+    // and friends can need more stack than the main thread gets.
+    constexpr std::size_t STACK_SIZE = std::size_t(1) << 30;
+
+    struct Phase {
+        const char *name;
+        double seconds;
+        std::size_t memory; // peak resident memory above what was in use when the phase began
+    };
+
+    struct Totals {
+        std::size_t bytes = 0;
+        std::size_t tokens = 0;
+        std::size_t nodes = 0;
+    };
+
+    std::size_t status_field(const char *field) {
+#if defined(__linux__)
+        std::ifstream status("/proc/self/status");
+        std::size_t length = std::char_traits<char>::length(field);
+        for (std::string line; std::getline(status, line);) {
+            if (line.compare(0, length, field) == 0) {
+                return std::stoul(line.substr(length)) * 1024;
+            }
+        }
+#endif
+        return 0;
+    }
+
+    // resident set size now, and its high-water mark since reset_peak()
+    std::size_t current_rss() {
+        return status_field("VmRSS:");
+    }
+
+    std::size_t peak_rss() {
+        std::size_t peak = status_field("VmHWM:");
+#if defined(__unix__) || defined(__APPLE__)
+        if (peak == 0) {
+            rusage usage{};
+            getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+            peak = static_cast<std::size_t>(usage.ru_maxrss);
+#else
+            peak = static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+        }
+#endif
+        return peak;
+    }
+
+    void reset_peak() {
+#if defined(__linux__)
+        std::ofstream("/proc/self/clear_refs") << "5"; // VmHWM restarts from the current RSS
+#endif
+    }
+
+    template <typename F>
+    Phase measure(const char *name, F &&body) {
+        reset_peak();
+        std::size_t before = current_rss();
+
+        auto start = std::chrono::steady_clock::now();
+        body();
+        auto stop = std::chrono::steady_clock::now();
+
+        std::size_t peak = peak_rss();
+        return {name, std::chrono::duration<double>(stop - start).count(), peak > before ? peak - before : 0};
+    }
+
+    std::size_t count_nodes(const Node *root) {
+        std::size_t count = 0;
+        std::vector<const Node *> pending{root};
+
+        while (!pending.empty()) {
+            const Node *n = pending.back();
+            pending.pop_back();
+            if (n == nullptr) {
+                continue;
+            }
+
+            count++;
+            pending.insert(std::end(pending), {n->o1, n->o2, n->o3});
+            if (n->has_call_args()) {
+                pending.insert(std::end(pending), std::begin(n->func_call_args), std::end(n->func_call_args));
+            } else if (n->kind == Node::BLOCK) {
+                pending.insert(std::end(pending), std::begin(n->statements), std::end(n->statements));
+            } else if (n->kind == Node::CLASS_DEFINE) {
+                for (auto &&method : n->class_def->methods) {
+                    pending.emplace_back(method.node);
+                }
+                for (auto &&property : n->class_def->properties) {
+                    pending.emplace_back(property.node);
+                }
+            }
+        }
+
+        return count;
+    }
+
+    void report(const Phase &phase, const Totals &totals) {
+        double mb = totals.bytes / 1e6;
+        double seconds = phase.seconds > 0 ? phase.seconds : 1e-9;
+
+        std::cout << std::fixed << std::setprecision(1)
+                  << "  " << std::left << std::setw(10) << phase.name << std::right
+                  << std::setw(10) << phase.seconds * 1e3 << " ms"
+                  << std::setw(10) << mb / seconds << " MB/s"
+                  << std::setw(10) << totals.tokens / seconds / 1e6 << " M tokens/s"
+                  << std::setw(8) << phase.seconds * 1e9 / std::max<std::size_t>(totals.tokens, 1) << " ns/token"
+                  << std::setw(10) << totals.nodes / seconds / 1e6 << " M nodes/s"
+                  << std::setw(10) << phase.memory / 1e6 << " MB peak" << std::endl;
+    }
+
+    // One-line edits of the program through an IncrementalParser: a
+    // changed literal, then an inserted statement, each at a random place.
+    void bench_edits(const std::string &source, unsigned edits, unsigned threads) {
+        IncrementalParser parser(source, threads);
+        parser.parse();
+
+        std::minstd_rand random(1);
+        auto run = [&](const char *name, auto &&pick) {
+            double seconds = 0;
+            std::size_t reparsed = 0;
+
+            for (unsigned i = 0; i != edits; i++) {
+                std::size_t offset = 0, removed = 0;
+                std::string inserted;
+                pick(parser.source(), random() % parser.source().size(), offset, removed, inserted);
+
+                auto start = std::chrono::steady_clock::now();
+                parser.edit(offset, removed, inserted);
+                seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                reparsed += parser.reparsed();
+            }
+
+            std::cout << std::fixed << std::setprecision(3)
+                      << "  " << std::left << std::setw(10) << "edit" << std::right
+                      << std::setw(10) << seconds * 1e3 / std::max(edits, 1u) << " ms per " << name << ", "
+                      << std::setprecision(1) << double(reparsed) / std::max(edits, 1u)
+                      << " statements parsed again" << std::endl;
+        };
+
+        run("changed literal", [](const std::string &text, std::size_t at, std::size_t &offset, std::size_t &removed, std::string &inserted) {
+            // the first digit of a number or a string after 'at', wrapping around
+            for (std::size_t n = 0; n != text.size(); n++, at = (at + 1) % text.size()) {
+                if (at != 0 && text[at] >= '1' && text[at] <= '9' && (text[at - 1] == ' ' || text[at - 1] == '(')) {
+                    break;
+                }
+            }
+            offset = at;
+            removed = 1;
+            inserted = text[at] == '9' ? "1" : std::string(1, static_cast<char>(text[at] + 1));
+        });
+        run("inserted line", [](const std::string &text, std::size_t at, std::size_t &offset, std::size_t &removed, std::string &inserted) {
+            // before a statement of some function body, after 'at' or else the first one
+            std::size_t line = text.find("\n    println ", at);
+            offset = (line != std::string::npos ? line : text.find("\n    println ")) + 1;
+            removed = 0;
+            inserted = "    println 1;\n";
+        });
+    }
+
+    // The generated modules optimized at 'level', written to <dir> and
+    // linked there, as the compiler does it; with the phases before, the
+    // time from source to a program.
+    void bench_build(std::vector<std::unique_ptr<Generator>> &units, optimization_level level, const std::string &dir,
+                     const Totals &totals, double front_end) {
+        InitializeNativeTarget();
+        InitializeNativeTargetAsmParser();
+        InitializeNativeTargetAsmPrinter();
+
+        std::vector<std::unique_ptr<TargetMachine>> machines(units.size());
+        std::vector<std::string> errors(units.size());
+        auto check = [&errors] {
+            for (auto &&error : errors) {
+                if (!error.empty()) {
+                    throw error;
+                }
+            }
+        };
+
+        Phase optimize = measure("optimize", [&] {
+            forEachModule(units.size(), [&](std::size_t i) {
+                Module *m = units[i]->module.get();
+                machines[i] = createTargetMachine(level, Processor(), errors[i]);
+                if (machines[i] != nullptr) {
+                    m->setTargetTriple(machines[i]->getTargetTriple().str());
+                    m->setDataLayout(machines[i]->createDataLayout());
+                    optimizeModule(m, machines[i].get(), level, units.size() == 1);
+                }
+            });
+        });
+        check();
+
+        std::vector<std::string> objects;
+        for (std::size_t i = 0; i != units.size(); i++) {
+            objects.push_back(dir + "/bench." + std::to_string(i) + ".o");
+        }
+        Phase emit = measure("emit", [&] {
+            forEachModule(units.size(), [&](std::size_t i) {
+                errors[i] = generateObject(units[i]->module.get(), machines[i].get(), objects[i]);
+            });
+        });
+        check();
+
+        std::string error;
+        Phase link_program = measure("link", [&] {
+            error = link(objects, dir + "/bench");
+        });
+        if (!error.empty()) {
+            throw error;
+        }
+
+        report(optimize, totals);
+        report(emit, totals);
+        report(link_program, totals);
+        std::cout << std::fixed << std::setprecision(1)
+                  << "  " << std::left << std::setw(10) << "total" << std::right
+                  << std::setw(10) << (front_end + optimize.seconds + emit.seconds + link_program.seconds) * 1e3
+                  << " ms from source to a linked program" << std::endl;
+    }
+
+    void bench(const SynthOptions &options, unsigned threads, bool codegen, unsigned edits, const std::string &cache_dir,
+               optimization_level level, const std::string &link_dir) {
+        std::string source = synthesize(options);
+
+        Totals totals;
+        totals.bytes = source.size();
+
+        Phase lex = measure("lex", [&] {
+            Lexer lexer;
+            lexer.load(source);
+            lexer.tokenize(threads);
+
+            do {
+                lexer.next_token(true);
+                totals.tokens++;
+            } while (lexer.sym != Lexer::EOI);
+        });
+
+        Lexer lexer;
+        lexer.load(source);
+        lexer.tokenize(threads);
+
+        Arena arena;
+        Node *ast = nullptr;
+        Phase parse = measure("parse", [&] {
+            Parser parser(&lexer, &arena, threads);
+            ast = parser.parse();
+        });
+        totals.nodes = count_nodes(ast);
+
+        std::cout << "input: " << std::fixed << std::setprecision(2) << totals.bytes / 1e6 << " MB, "
+                  << std::count(std::begin(source), std::end(source), '\n') << " lines, "
+                  << totals.tokens << " tokens, " << totals.nodes << " AST nodes, "
+                  << arena.bytes() / totals.nodes << " bytes per node" << std::endl;
+        report(lex, totals);
+        report(parse, totals);
+
+        if (edits != 0) {
+            bench_edits(source, edits, threads);
+        }
+
+        std::unique_ptr<AstCache> cache;
+        if (!cache_dir.empty()) {
+            bool stored = false;
+            Phase store = measure("store", [&] {
+                stored = AstCache(cache_dir).store(source, ast);
+            });
+            if (!stored) {
+                throw std::string("cannot write to the AST cache in " + cache_dir);
+            }
+
+            cache = std::make_unique<AstCache>(cache_dir);
+            Phase load = measure("load", [&] {
+                ast = cache->load(source);
+            });
+            report(store, totals);
+            report(load, totals);
+        }
+
+        Phase resolve = measure("resolve", [&] {
+            Resolver().resolve(ast);
+        });
+        report(resolve, totals);
+
+        if (codegen) {
+            std::unique_ptr<ParallelGenerator> generator;
+            Phase generate = measure("generate", [&] {
+                generator = std::make_unique<ParallelGenerator>(false, "bench", threads);
+                generator->generate(ast);
+            });
+            report(generate, totals);
+
+            if (!link_dir.empty()) {
+                bench_build(generator->units, level, link_dir, totals, lex.seconds + parse.seconds + resolve.seconds + generate.seconds);
+            }
+        }
+    }
+
+    std::size_t parse_size(const std::string &value) {
+        std::size_t end = 0;
+        std::size_t size = std::stoul(value, &end);
+
+        switch (end < value.size() ? value[end] : ' ') {
+            case 'k':
+            case 'K':
+                return size << 10;
+            case 'm':
+            case 'M':
+                return size << 20;
+            default:
+                return size;
+        }
+    }
+
+    void show_usage() {
+        std::cout << "USAGE: turnip2-bench [options]" << std::endl
+                  << "OPTIONS:" << std::endl
+                  << "\t -functions <n>    functions in the program (default 100)" << std::endl
+                  << "\t -classes <n>      classes in the program (default 10)" << std::endl
+                  << "\t -statements <n>   statements per function (default 20)" << std::endl
+                  << "\t -depth <n>        deepest nesting of blocks (default 2)" << std::endl
+                  << "\t -identifiers <n>  local variables per function (default 8)" << std::endl
+                  << "\t -literals <n>     percent of operands that are literals (default 50)" << std::endl
+                  << "\t -operators <n>    most binary operators in an expression (default 2)" << std::endl
+                  << "\t -nesting <n>      deepest parenthesized sub-expression (default 0)" << std::endl
+                  << "\t -size <n>[K|M]    add functions until the program is this long" << std::endl
+                  << "\t -seed <n>         seed of the generator (default 1)" << std::endl
+                  << "\t -threads <n>      lexer, parser and generator threads (default: all)" << std::endl
+                  << "\t -sweep            run every size from 10K to 100M" << std::endl
+                  << "\t -edits <n>        time <n> one-line edits of each kind, parsed incrementally" << std::endl
+                  << "\t -cache <dir>      time storing the tree in an AST cache in <dir> and loading it back" << std::endl
+                  << "\t -no-codegen       skip the generator phase" << std::endl
+                  << "\t -link <dir>       time optimizing, writing the objects to <dir> and linking them there" << std::endl
+                  << "\t -O<level>         optimization of -link: -O0 (default), -O1, -O2, -O3 or -Os" << std::endl
+                  << "\t -emit <file>      write the program to <file> and exit" << std::endl;
+    }
+
+    // runs 'body' on a thread with a STACK_SIZE stack
+    int run_with_stack(const std::function<int()> &body) {
+#if defined(__unix__) || defined(__APPLE__)
+        struct Call {
+            const std::function<int()> &body;
+            int result;
+        } call{body, 1};
+
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setstacksize(&attr, STACK_SIZE);
+
+        pthread_t thread;
+        int created = pthread_create(&thread, &attr, [](void *p) -> void * {
+            auto *c = static_cast<Call *>(p);
+            c->result = c->body();
+            return nullptr;
+        }, &call);
+        pthread_attr_destroy(&attr);
+
+        if (created == 0) {
+            pthread_join(thread, nullptr);
+            return call.result;
+        }
+#endif
+        return body();
+    }
+}
+
+int main(int argc, char **argv) {
+    SynthOptions options;
+    unsigned threads = std::thread::hardware_concurrency();
+    bool sweep = false;
+    bool codegen = true;
+    unsigned edits = 0;
+    std::string cache;
+    std::string emit;
+    std::string link_dir;
+    optimization_level level = O0;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string option = argv[i];
+            bool value = i + 1 < argc;
+
+            if (option == "-functions" && value) {
+                options.functions = static_cast<unsigned>(std::stoul(argv[++i]));
+            } else if (option == "-classes" && value) {
+                options.classes = static_cast<unsigned>(std::stoul(argv[++i]));
+            } else if (option == "-statements" && value) {
+                options.statements = static_cast<unsigned>(std::stoul(argv[++i]));
+            } else if (option == "-depth" && value) {
+                options.depth = static_cast<unsigned>(std::stoul(argv[++i]));
+            } else if (option == "-identifiers" && value) {
+                options.identifiers = static_cast<unsigned>(std::stoul(argv[++i]));
+            } else if (option == "-literals" && value) {
+                options.literals = static_cast<unsigned>(std::stoul(argv[++i]));
+            } else if (option == "-operators" && value) {
+                options.operators = static_cast<unsigned>(std::stoul(argv[++i]));
+            } else if (option == "-nesting" && value) {
+                options.nesting = static_cast<unsigned>(std::stoul(argv[++i]));
+            } else if (option == "-size" && value) {
+                options.size = parse_size(argv[++i]);
+            } else if (option == "-seed" && value) {
+                options.seed = std::stoull(argv[++i]);
+            } else if (option == "-threads" && value) {
+                threads = static_cast<unsigned>(std::stoul(argv[++i]));
+            } else if (option == "-edits" && value) {
+                edits = static_cast<unsigned>(std::stoul(argv[++i]));
+            } else if (option == "-cache" && value) {
+                cache = argv[++i];
+            } else if (option == "-emit" && value) {
+                emit = argv[++i];
+            } else if (option == "-link" && value) {
+                link_dir = argv[++i];
+            } else if (option == "-O0" || option == "-O1" || option == "-O2" || option == "-O3" || option == "-Os") {
+                const std::string levels = "0123s";
+                level = static_cast<optimization_level>(levels.find(option[2]));
+            } else if (option == "-sweep") {
+                sweep = true;
+            } else if (option == "-no-codegen") {
+                codegen = false;
+            } else {
+                show_usage();
+                return option == "-h" || option == "-help" ? 0 : 1;
+            }
+        }
+    } catch (const std::logic_error &) { // std::stoul rejected a number
+        show_usage();
+        return 1;
+    }
+
+    if (!emit.empty()) {
+        std::ofstream(emit, std::ios::binary) << synthesize(options);
+        return 0;
+    }
+
+    return run_with_stack([&] {
+        try {
+            if (!sweep) {
+                bench(options, threads, codegen, edits, cache, level, link_dir);
+                return 0;
+            }
+
+            for (std::size_t size = 10 << 10; size <= 100 << 20; size *= 10) {
+                options.size = size;
+                bench(options, threads, codegen, edits, cache, level, link_dir);
+            }
+        } catch (const std::string &err) {
+            std::cerr << "error: " << err << std::endl;
+            return 1;
+        }
+
+        return 0;
+    });
+}
@@ -0,0 +1,492 @@
+//
+// Created by NEzyaka on 17.10.26.
+//
+
+#include "cache.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <unordered_map>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if __has_include("version.h")
+#include "version.h" // a hash of the compiler's sources, written by the build
+#endif
+
+#ifndef TURNIP2_VERSION
+#define TURNIP2_VERSION "dev"
+#endif
+
+namespace {
+    constexpr char MAGIC[8] = {'t', 'u', 'r', 'n', 'i', 'p', '2', 0};
+    constexpr std::uint32_t FORMAT = 3; // bumped whenever Node or the layout below changes
+
+    // Every offset is from the start of the file. The nodes are an array of
+    // Node whose pointers hold offsets, 0 for nullptr; what they point to
+    // (call arguments, statements, string literals and the records below)
+    // follows them. Symbols hold the ids they had when the tree was parsed.
+    struct Header {
+        char magic[8];
+        std::uint32_t format;
+        std::uint32_t node_size;
+        std::uint64_t key;
+        std::uint64_t source_size;
+        std::uint64_t root;
+        std::uint64_t nodes;
+        std::uint64_t node_count;
+        std::uint64_t symbols; // SymbolRecord array, by ascending id
+        std::uint64_t symbol_count;
+    };
+
+    constexpr std::uint64_t NODES = (sizeof(Header) + 63) / 64 * 64; // a node per cache line
+
+    struct SymbolRecord {
+        std::uint32_t id;
+        std::uint32_t length;
+        std::uint64_t text;
+    };
+
+    // ARG_LIST: a count, then one per argument in declaration order
+    struct ArgRecord {
+        std::uint32_t name;
+        std::uint32_t value_type;
+        std::uint32_t user_type;
+        std::uint32_t unused;
+    };
+
+    // CLASS_DEFINE: the number of methods and of properties, then one per member
+    struct MemberRecord {
+        std::uint32_t name;
+        std::int32_t access;
+        std::uint64_t node;
+    };
+
+    // MurmurHash64A
+    std::uint64_t hash(std::string_view s, std::uint64_t seed) {
+        const std::uint64_t m = 0xc6a4a7935bd1e995ull;
+        const int r = 47;
+
+        std::uint64_t h = seed ^ (s.size() * m);
+        const char *p = s.data();
+        const char *end = p + s.size() / 8 * 8;
+
+        for (; p != end; p += 8) {
+            std::uint64_t k;
+            std::memcpy(&k, p, 8);
+            k *= m;
+            k ^= k >> r;
+            k *= m;
+            h ^= k;
+            h *= m;
+        }
+
+        std::size_t rest = s.size() & 7;
+        if (rest != 0) {
+            std::uint64_t k = 0;
+            std::memcpy(&k, p, rest);
+            h ^= k;
+            h *= m;
+        }
+
+        h ^= h >> r;
+        h *= m;
+        h ^= h >> r;
+        return h;
+    }
+
+    std::uint64_t key_of(std::string_view source) {
+        return hash(source, hash(TURNIP2_VERSION, FORMAT));
+    }
+
+    template <typename T>
+    std::uint64_t offset_of(const T *p) {
+        return static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(p));
+    }
+
+    template <typename T>
+    T *as_pointer(std::uint64_t offset) {
+        return reinterpret_cast<T *>(static_cast<std::uintptr_t>(offset));
+    }
+
+    class Writer {
+        std::vector<const Node *> nodes;
+        std::unordered_map<const Node *, std::uint64_t> offsets;
+        std::vector<char> heap; // what the nodes point to, behind them in the file
+        std::uint64_t heap_start = 0;
+        std::vector<Symbol> spelled; // every symbol the tree uses, by id
+
+        // nodes in the order they are found, a node shared by two parents is written once
+        void collect(const Node *root) {
+            std::vector<const Node *> pending;
+            auto add = [&](const Node *n) {
+                if (n != nullptr && offsets.emplace(n, NODES + nodes.size() * sizeof(Node)).second) {
+                    nodes.push_back(n);
+                    pending.push_back(n);
+                }
+            };
+
+            add(root);
+            while (!pending.empty()) {
+                const Node *n = pending.back();
+                pending.pop_back();
+
+                for (const Node *child : {n->o1, n->o2, n->o3}) {
+                    add(child);
+                }
+                if (n->has_call_args()) {
+                    std::for_each(std::begin(n->func_call_args), std::end(n->func_call_args), add);
+                } else if (n->kind == Node::BLOCK) {
+                    std::for_each(std::begin(n->statements), std::end(n->statements), add);
+                } else if (n->kind == Node::CLASS_DEFINE) {
+                    for (auto &&method : n->class_def->methods) {
+                        add(method.node);
+                    }
+                    for (auto &&property : n->class_def->properties) {
+                        add(property.node);
+                    }
+                }
+            }
+        }
+
+        std::uint64_t offset(const Node *n) const {
+            return n != nullptr ? offsets.at(n) : 0;
+        }
+
+        std::uint32_t symbol(Symbol s) {
+            if (s.index() >= spelled.size()) {
+                spelled.resize(s.index() + 1);
+            }
+            spelled[s.index()] = s;
+            return s.index();
+        }
+
+        // 'size' bytes at the end of the heap, aligned for any record
+        std::uint64_t append(const void *data, std::size_t size) {
+            heap.resize((heap.size() + 7) / 8 * 8);
+            std::uint64_t at = heap_start + heap.size();
+            heap.insert(std::end(heap), static_cast<const char *>(data), static_cast<const char *>(data) + size);
+            return at;
+        }
+
+        NodeList list(const NodeList &items) {
+            if (items.empty()) {
+                return {};
+            }
+
+            std::vector<std::uint64_t> at;
+            for (const Node *item : items) {
+                at.push_back(offset(item));
+            }
+            return {as_pointer<Node *>(append(at.data(), at.size() * sizeof(std::uint64_t))), items.size()};
+        }
+
+        Node record(const Node *n) {
+            Node x = *n;
+            x.o1 = as_pointer<Node>(offset(n->o1));
+            x.o2 = as_pointer<Node>(offset(n->o2));
+            x.o3 = as_pointer<Node>(offset(n->o3));
+            symbol(n->user_type);
+            symbol(n->var_name);
+            symbol(n->property_name);
+
+            if (n->kind == Node::CONST && n->value_type == Node::STRING) {
+                x.str_val = {as_pointer<const char>(n->str_val.empty() ? 0 : append(n->str_val.data(), n->str_val.size())), n->str_val.size()};
+            } else if (n->has_call_args()) {
+                x.func_call_args = list(n->func_call_args);
+            } else if (n->kind == Node::BLOCK) {
+                x.statements = list(n->statements);
+            } else if (n->kind == Node::ARG_LIST) {
+                std::vector<ArgRecord> args{{static_cast<std::uint32_t>(n->func_def_args->size()), 0, 0, 0}};
+                for (auto &&arg : *n->func_def_args) {
+                    args.push_back({symbol(arg.first), static_cast<std::uint32_t>(arg.second->value_type), symbol(arg.second->user_type_name), 0});
+                }
+                x.func_def_args = as_pointer<ArgTypes>(append(args.data(), args.size() * sizeof(ArgRecord)));
+            } else if (n->kind == Node::CLASS_DEFINE) {
+                std::vector<MemberRecord> members{{static_cast<std::uint32_t>(n->class_def->methods.size()),
+                                                   static_cast<std::int32_t>(n->class_def->properties.size()), 0}};
+                for (auto *table : {&n->class_def->methods, &n->class_def->properties}) {
+                    for (auto &&member : *table) {
+                        members.push_back({symbol(member.name), member.access_type, offset(member.node)});
+                    }
+                }
+                x.class_def = as_pointer<ClassBody>(append(members.data(), members.size() * sizeof(MemberRecord)));
+            }
+
+            return x;
+        }
+
+    public:
+        std::vector<char> write(const Node *root, std::uint64_t key, std::size_t source_size) {
+            collect(root);
+            heap_start = NODES + nodes.size() * sizeof(Node);
+
+            std::vector<char> image(heap_start);
+            for (std::size_t i = 0; i != nodes.size(); i++) {
+                Node x = record(nodes[i]);
+                std::memcpy(image.data() + NODES + i * sizeof(Node), &x, sizeof(Node));
+            }
+
+            std::vector<SymbolRecord> symbols;
+            for (Symbol s : spelled) {
+                if (!s.empty()) {
+                    symbols.push_back({s.index(), static_cast<std::uint32_t>(s.str().size()), append(s.str().data(), s.str().size())});
+                }
+            }
+
+            Header header{};
+            std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+            header.format = FORMAT;
+            header.node_size = sizeof(Node);
+            header.key = key;
+            header.source_size = source_size;
+            header.root = offset(root);
+            header.nodes = NODES;
+            header.node_count = nodes.size();
+            header.symbol_count = symbols.size();
+            header.symbols = append(symbols.data(), symbols.size() * sizeof(SymbolRecord));
+            std::memcpy(image.data(), &header, sizeof(Header));
+
+            image.insert(std::end(image), std::begin(heap), std::end(heap));
+            return image;
+        }
+    };
+
+    void release(char *data, std::size_t size, bool mapped) {
+#if defined(__unix__) || defined(__APPLE__)
+        if (mapped) {
+            munmap(data, size);
+            return;
+        }
+#endif
+        (void) size;
+        (void) mapped;
+        delete[] data;
+    }
+}
+
+AstCache::~AstCache() {
+    for (auto &&mapping : mappings) {
+        release(mapping.data, mapping.size, mapping.mapped);
+    }
+}
+
+std::string AstCache::path(std::uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%016llx.ast", static_cast<unsigned long long>(key));
+    return directory + name;
+}
+
+// Turns the offsets of a file read to 'data' back into pointers, nullptr
+// when the file is not a tree of this source or is damaged.
+Node *AstCache::relocate(char *data, std::size_t size, std::uint64_t key, std::size_t source_size) {
+    auto inside = [size](std::uint64_t offset, std::uint64_t bytes) {
+        return offset % 8 == 0 && offset <= size && bytes <= size - offset;
+    };
+
+    Header header{};
+    if (size < sizeof(Header)) {
+        return nullptr;
+    }
+    std::memcpy(&header, data, sizeof(Header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.format != FORMAT ||
+        header.node_size != sizeof(Node) || header.key != key || header.source_size != source_size ||
+        header.node_count > size / sizeof(Node) || !inside(header.nodes, header.node_count * sizeof(Node)) ||
+        header.symbol_count > size / sizeof(SymbolRecord) || !inside(header.symbols, header.symbol_count * sizeof(SymbolRecord))) {
+        return nullptr;
+    }
+
+    // the ids the tree was parsed with, to the ones of this process
+    std::vector<Symbol> symbols(1);
+    auto *records = reinterpret_cast<const SymbolRecord *>(data + header.symbols);
+    for (std::uint64_t i = 0; i != header.symbol_count; i++) {
+        const SymbolRecord &s = records[i];
+        if (s.id < symbols.size() || s.text > size || s.length > size - s.text) {
+            return nullptr;
+        }
+        symbols.resize(s.id + 1);
+        symbols[s.id] = intern({data + s.text, s.length});
+    }
+
+    bool ok = true;
+    auto symbol = [&](Symbol &s) {
+        if (s.index() < symbols.size()) {
+            s = symbols[s.index()];
+        } else {
+            ok = false;
+        }
+    };
+    auto spelled = [&](std::uint32_t id) {
+        return id < symbols.size() ? symbols[id] : (ok = false, Symbol());
+    };
+    auto node = [&](std::uint64_t offset) -> Node * {
+        if (offset == 0) {
+            return nullptr;
+        }
+        if (offset < header.nodes || (offset - header.nodes) % sizeof(Node) != 0 || (offset - header.nodes) / sizeof(Node) >= header.node_count) {
+            ok = false;
+            return nullptr;
+        }
+        return reinterpret_cast<Node *>(data + offset);
+    };
+    auto list = [&](NodeList &items) {
+        std::uint64_t at = offset_of(items.begin());
+        if (items.empty() || !inside(at, std::uint64_t(items.size()) * sizeof(std::uint64_t))) {
+            ok = ok && items.empty();
+            items = {};
+            return;
+        }
+
+        auto **to = reinterpret_cast<Node **>(data + at);
+        for (std::uint32_t i = 0; i != items.size(); i++) {
+            std::uint64_t item;
+            std::memcpy(&item, to + i, sizeof(item));
+            to[i] = node(item);
+        }
+        items = {to, items.size()};
+    };
+
+    auto *nodes = reinterpret_cast<Node *>(data + header.nodes);
+    for (std::uint64_t i = 0; ok && i != header.node_count; i++) {
+        Node &n = nodes[i];
+        n.o1 = node(offset_of(n.o1));
+        n.o2 = node(offset_of(n.o2));
+        n.o3 = node(offset_of(n.o3));
+        symbol(n.user_type);
+        symbol(n.var_name);
+        symbol(n.property_name);
+
+        if (n.kind == Node::CONST && n.value_type == Node::STRING) {
+            std::uint64_t at = offset_of(n.str_val.data());
+            if (n.str_val.empty()) {
+                n.str_val = {};
+            } else if (at <= size && n.str_val.size() <= size - at) {
+                n.str_val = {data + at, n.str_val.size()};
+            } else {
+                ok = false;
+            }
+        } else if (n.has_call_args()) {
+            list(n.func_call_args);
+        } else if (n.kind == Node::BLOCK) {
+            list(n.statements);
+        } else if (n.kind == Node::ARG_LIST) {
+            std::uint64_t at = offset_of(n.func_def_args);
+            ArgRecord count{};
+            if (!inside(at, sizeof(ArgRecord))) {
+                return nullptr;
+            }
+            std::memcpy(&count, data + at, sizeof(ArgRecord));
+            if (!inside(at, (std::uint64_t(count.name) + 1) * sizeof(ArgRecord))) {
+                return nullptr;
+            }
+
+            auto *args = reinterpret_cast<const ArgRecord *>(data + at) + 1;
+            n.func_def_args = arena.make<ArgTypes>();
+            for (std::uint32_t k = 0; k != count.name; k++) {
+                n.func_def_args->emplace(spelled(args[k].name), std::make_shared<types::Type>(args[k].value_type, spelled(args[k].user_type)));
+            }
+        } else if (n.kind == Node::CLASS_DEFINE) {
+            std::uint64_t at = offset_of(n.class_def);
+            MemberRecord count{};
+            if (!inside(at, sizeof(MemberRecord))) {
+                return nullptr;
+            }
+            std::memcpy(&count, data + at, sizeof(MemberRecord));
+            std::uint64_t methods = count.name;
+            auto properties = static_cast<std::uint32_t>(count.access);
+            if (!inside(at, (methods + properties + 1) * sizeof(MemberRecord))) {
+                return nullptr;
+            }
+
+            auto *members = reinterpret_cast<const MemberRecord *>(data + at) + 1;
+            n.class_def = arena.make<ClassBody>();
+            for (std::uint32_t k = 0; k != methods + properties; k++) {
+                auto &list = k < methods ? n.class_def->methods : n.class_def->properties;
+                list.push_back({spelled(members[k].name), static_cast<int>(members[k].access), node(members[k].node)});
+            }
+        }
+    }
+
+    Node *root = node(header.root);
+    return ok ? root : nullptr;
+}
+
+Node *AstCache::load(std::string_view source) {
+    std::uint64_t key = key_of(source);
+    std::string file = path(key);
+    Mapping mapping{nullptr, 0, false};
+
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return nullptr;
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) >= sizeof(Header)) {
+        // private and writable: relocating touches only this process's copy of the pages
+        void *addr = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            mapping = {static_cast<char *>(addr), static_cast<std::size_t>(st.st_size), true};
+        }
+    }
+    close(fd);
+#else
+    std::ifstream in(file, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (!bytes.empty()) {
+        mapping = {new char[bytes.size()], bytes.size(), false};
+        std::copy(std::begin(bytes), std::end(bytes), mapping.data);
+    }
+#endif
+
+    if (mapping.data == nullptr) {
+        return nullptr;
+    }
+
+    Node *root = relocate(mapping.data, mapping.size, key, source.size());
+    if (root == nullptr) {
+        release(mapping.data, mapping.size, mapping.mapped);
+        return nullptr;
+    }
+
+    mappings.push_back(mapping);
+    return root;
+}
+
+bool AstCache::store(std::string_view source, const Node *root) const {
+    std::uint64_t key = key_of(source);
+    std::vector<char> image = Writer().write(root, key, source.size());
+
+    // written aside and renamed, so a concurrent build never maps half a file
+    std::string file = path(key);
+#if defined(__unix__) || defined(__APPLE__)
+    std::string temporary = file + "." + std::to_string(getpid());
+#else
+    std::string temporary = file + ".tmp";
+#endif
+
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(image.data(), static_cast<std::streamsize>(image.size()));
+        if (!out) {
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+
+    if (std::rename(temporary.c_str(), file.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,54 @@
+//
+// Created by NEzyaka on 17.10.26.
+//
+
+#ifndef TURNIP2_CACHE_H
+#define TURNIP2_CACHE_H
+
+#include "arena.h"
+#include "utilities.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace turnip2;
+
+// Parsed trees on disk, one file per source text and compiler version. A
+// file holds the nodes as they are in memory, their pointers turned into
+// offsets from the start of the file; a hit maps it copy-on-write and turns
+// them back in place, so the tree is used where it lies instead of being
+// read into new nodes. Only the hash maps hung off argument lists and
+// classes are built anew, in an arena.
+class AstCache {
+    std::string directory;
+
+    struct Mapping {
+        char *data;
+        std::size_t size;
+        bool mapped; // from mmap, otherwise new[]
+    };
+
+    std::vector<Mapping> mappings; // of the trees handed out, freed with the cache
+    Arena arena;
+
+    std::string path(std::uint64_t key) const;
+    Node *relocate(char *data, std::size_t size, std::uint64_t key, std::size_t source_size);
+
+public:
+    explicit AstCache(std::string dir) : directory(std::move(dir)) {}
+    ~AstCache();
+
+    AstCache(const AstCache &) = delete;
+    AstCache &operator=(const AstCache &) = delete;
+
+    // The tree of 'source' if it is in the cache, nullptr otherwise. It
+    // lives as long as the cache does.
+    Node *load(std::string_view source);
+
+    // false when the file could not be written, the cache is only ever an optimization
+    bool store(std::string_view source, const Node *root) const;
+};
+
+
+#endif //TURNIP2_CACHE_H
@@ -2,81 +2,113 @@
 // Created by NEzyaka on 29.09.16.
 //
 
+#include <algorithm>
+#include <exception>
 #include <iostream>
+#include <limits>
+#include <thread>
 #include <llvm/ADT/APInt.h>
 #include <llvm/ADT/APFloat.h>
 #include <llvm/IR/InstrTypes.h>
 #include "generator.h"
 
+namespace {
+    // where each of 'count' runs of top-level statements begins, then the
+    // end; a run spans about as many lines as the others and none is empty
+    std::vector<std::size_t> split(const std::vector<Node *> &statements, unsigned count) {
+        std::size_t size = statements.size();
+        double first = statements.front()->location.line;
+        double lines = statements.back()->location.line - first + 1;
+
+        std::vector<std::size_t> bounds{0};
+        for (unsigned run = 1; run < count; run++) {
+            std::size_t b = bounds.back() + 1;
+            while (b < size - (count - run) && statements[b]->location.line < first + lines * run / count) {
+                b++;
+            }
+            bounds.push_back(b);
+        }
+        bounds.push_back(size);
+        return bounds;
+    }
+}
+
 void Generator::error(unsigned line, const std::string &e) {
     throw std::string(std::to_string(line) + " -> " + e);
 }
 
-Generator::Generator(bool opt, bool genDI, const std::string &f) : optimize(opt), generateDI(genDI), file (f) {
+Generator::Generator(bool genDI, const std::string &f) : file(f), generateDI(genDI) {
     module = std::make_unique<Module>(file, context);
     builder = std::make_unique<IRBuilder<>>(context);
 
     if (generateDI) {
+        module->addModuleFlag(Module::Warning, "Debug Info Version", DEBUG_METADATA_VERSION);
         dbuilder = std::make_unique<DIBuilder>(*module.get());
         compileUnit = dbuilder->createCompileUnit(
                 dwarf::DW_LANG_C,
-                file,
-                ".",
+                dbuilder->createFile(file, "."),
                 "turnip2",
-                0,
+                false,
                 "",
                 0
         );
     }
-
-    if (optimize) {
-        passmgr = std::make_unique<legacy::FunctionPassManager>(module.get());
-        passmgr->add(createInstructionSimplifierPass());
-        passmgr->add(createInstructionCombiningPass());
-        passmgr->add(createReassociatePass());
-        passmgr->add(createDeadCodeEliminationPass());
-        passmgr->add(createDeadInstEliminationPass());
-        passmgr->add(createDeadStoreEliminationPass());
-        passmgr->add(createConstantHoistingPass());
-        passmgr->add(createLoadCombinePass());
-        passmgr->add(createAggressiveDCEPass());
-        passmgr->add(createLoopLoadEliminationPass());
-        passmgr->add(createConstantPropagationPass());
-        passmgr->add(createCFGSimplificationPass());
-        passmgr->add(createMemCpyOptPass());
-        passmgr->doInitialization();
-    }
 }
 
 void Generator::use_io() {
     io_using = true;
 
-    table.emplace("int_out_format", builder->CreateGlobalStringPtr("%i\n", "int_out_format"));
-    table.emplace("float_out_format", builder->CreateGlobalStringPtr("%f\n", "float_out_format"));
-    table.emplace("str_out_format", builder->CreateGlobalStringPtr("%s\n", "str_out_format"));
+    int_out_format = builder->CreateGlobalStringPtr("%i\n", "int_out_format");
+    float_out_format = builder->CreateGlobalStringPtr("%f\n", "float_out_format");
+    str_out_format = builder->CreateGlobalStringPtr("%s\n", "str_out_format");
 
     printfArgs.emplace_back(Type::getInt8PtrTy(context)); // create the prototype of printf function
     printfType = FunctionType::get(Type::getInt32Ty(context), printfArgs, true);
     printf = module->getOrInsertFunction("printf", printfType);
 
-    table.emplace("float_in_format", builder->CreateGlobalStringPtr("%d", "float_in_format"));
-    table.emplace("str_in_format", builder->CreateGlobalStringPtr("%255s", "str_in_format"));
+    float_in_format = builder->CreateGlobalStringPtr("%d", "float_in_format");
+    str_in_format = builder->CreateGlobalStringPtr("%255s", "str_in_format");
 
     scanfArgs.emplace_back(Type::getInt8PtrTy(context)); // create the prototype of scanf function
     scanfType = FunctionType::get(Type::getInt32Ty(context), scanfArgs, true);
     scanf = module->getOrInsertFunction("scanf", scanfType);
 }
 
-void Generator::generate(const std::shared_ptr<Node>& n) {
+void Generator::declare(const Node *n, Value *address) {
+    variable(n).address = address;
+}
+
+Value *Generator::convert(Value *val, unsigned char type) {
+    if (type == Node::INTEGER && val->getType()->isDoubleTy()) {
+        return builder->CreateFPToSI(val, Type::getInt32Ty(context));
+    } else if (type == Node::FLOATING && val->getType()->isIntegerTy(32)) {
+        return builder->CreateSIToFP(val, Type::getDoubleTy(context));
+    } else if (type == Node::BOOL && val->getType()->isDoubleTy()) {
+        return builder->CreateFPToUI(val, Type::getInt1Ty(context));
+    } else if (type == Node::FLOATING && val->getType()->isIntegerTy(1)) {
+        return builder->CreateUIToFP(val, Type::getDoubleTy(context));
+    }
+    return val;
+}
+
+Generator::ClassDefinition *Generator::class_of(Value *object) {
+    Type *type = object->getType();
+    while (type->isPointerTy()) {
+        type = type->getPointerElementType();
+    }
+    return classes.at(cast<StructType>(type));
+}
+
+void Generator::generate(Node *n) {
     switch(n->kind) {
         case Node::VAR_DEF: {
             if (n->o1 != nullptr) { // new array
                 if (n->o1->kind == Node::ARRAY) {
-                    std::shared_ptr<Node> arr = n->o1;
+                    Node *arr = n->o1;
                     generate(arr->o1);
                     Value *elements_count_val = stack.top();
                     stack.pop();
-                    array_sizes.emplace(n->var_name, elements_count_val);
+                    variable(n).elements = elements_count_val;
 
                     // get number of elements in array
                     int64_t elements_count = 0;
@@ -90,23 +122,22 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                     }
 
                     switch (arr->value_type) {
-                        last_vars.emplace_back(n->var_name);
                         case Node::INTEGER: { // integer array
-                            table.emplace(
-                                    n->var_name,
+                            declare(
+                                    n,
                                     builder->CreateAlloca(
                                             ArrayType::get(
                                                     Type::getInt32Ty(context),
                                                     static_cast<uint64_t>(elements_count)
                                             ),
                                             nullptr,
-                                            n->var_name + "_ptr"
+                                            n->var_name.str() + "_ptr"
                                     )
                             );
                             if (generateDI) {
                                 DILocalVariable *var = dbuilder->createAutoVariable(
                                         lexical_blocks.back(),
-                                        n->var_name,
+                                        n->var_name.str(),
                                         unit,
                                         n->location.line,
                                         dbuilder->createArrayType(
@@ -117,10 +148,11 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                                         )
                                 );
                                 dbuilder->insertDeclare(
-                                        table.at(n->var_name),
+                                        variable(n).address,
                                         var,
                                         dbuilder->createExpression(),
-                                        DebugLoc::get(
+                                        DILocation::get(
+                                                context,
                                                 (n->location.line),
                                                 0,
                                                 lexical_blocks.back()
@@ -131,21 +163,21 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                             break;
                         }
                         case Node::FLOATING: { // float array
-                            table.emplace(
-                                    n->var_name,
+                            declare(
+                                    n,
                                     builder->CreateAlloca(
                                             ArrayType::get(
                                                     Type::getDoubleTy(context),
                                                     static_cast<uint64_t>(elements_count)
                                             ),
                                             nullptr,
-                                            n->var_name + "_ptr"
+                                            n->var_name.str() + "_ptr"
                                     )
                             );
                             if (generateDI) {
                                 DILocalVariable *var = dbuilder->createAutoVariable(
                                         lexical_blocks.back(),
-                                        n->var_name,
+                                        n->var_name.str(),
                                         unit,
                                         n->location.line,
                                         dbuilder->createArrayType(
@@ -156,10 +188,11 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                                         )
                                 );
                                 dbuilder->insertDeclare(
-                                        table.at(n->var_name),
+                                        variable(n).address,
                                         var,
                                         dbuilder->createExpression(),
-                                        DebugLoc::get(
+                                        DILocation::get(
+                                                context,
                                                 (n->location.line),
                                                 0,
                                                 lexical_blocks.back()
@@ -170,21 +203,21 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                             break;
                         }
                         case Node::STRING: { // string array
-                            table.emplace(
-                                    n->var_name,
+                            declare(
+                                    n,
                                     builder->CreateAlloca(
                                             ArrayType::get(
                                                     ArrayType::get(Type::getInt8Ty(context), 256),
                                                     static_cast<uint64_t>(elements_count)
                                             ),
                                             nullptr,
-                                            n->var_name + "_ptr"
+                                            n->var_name.str() + "_ptr"
                                     )
                             );
                             if (generateDI) {
                                 DILocalVariable *var = dbuilder->createAutoVariable(
                                         lexical_blocks.back(),
-                                        n->var_name,
+                                        n->var_name.str(),
                                         unit,
                                         n->location.line,
                                         dbuilder->createArrayType(
@@ -195,10 +228,11 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                                         )
                                 );
                                 dbuilder->insertDeclare(
-                                        table.at(n->var_name),
+                                        variable(n).address,
                                         var,
                                         dbuilder->createExpression(),
-                                        DebugLoc::get(
+                                        DILocation::get(
+                                                context,
                                                 (n->location.line),
                                                 0,
                                                 lexical_blocks.back()
@@ -209,21 +243,21 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                             break;
                         }
                         case Node::BOOL: { // bool array
-                            table.emplace(
-                                    n->var_name,
+                            declare(
+                                    n,
                                     builder->CreateAlloca(
                                             ArrayType::get(
                                                     Type::getInt1Ty(context),
                                                     static_cast<uint64_t>(elements_count)
                                             ),
                                             nullptr,
-                                            n->var_name + "_ptr"
+                                            n->var_name.str() + "_ptr"
                                     )
                             );
                             if (generateDI) {
                                 DILocalVariable *var = dbuilder->createAutoVariable(
                                         lexical_blocks.back(),
-                                        n->var_name,
+                                        n->var_name.str(),
                                         unit,
                                         n->location.line,
                                         dbuilder->createArrayType(
@@ -234,10 +268,11 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                                         )
                                 );
                                 dbuilder->insertDeclare(
-                                        table.at(n->var_name),
+                                        variable(n).address,
                                         var,
                                         dbuilder->createExpression(),
-                                        DebugLoc::get(
+                                        DILocation::get(
+                                                context,
                                                 (n->location.line),
                                                 0,
                                                 lexical_blocks.back()
@@ -248,15 +283,15 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                             break;
                         }
                         case Node::USER: // user type array TODO debug info
-                            table.emplace(
-                                    n->var_name,
+                            declare(
+                                    n,
                                     builder->CreateAlloca(
                                             ArrayType::get(
                                                     PointerType::get(user_types.at(n->user_type)->llvm_type, 0),
                                                     static_cast<uint64_t>(elements_count)
                                             ),
                                             nullptr,
-                                            n->var_name + "_ptr"
+                                            n->var_name.str() + "_ptr"
                                     )
                             );
                             break;
@@ -264,30 +299,30 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                 }
             }
             else { // just variable
-                last_vars.emplace_back(n->var_name);
                 switch (n->value_type) {
                     case Node::INTEGER: { // int variable
-                        table.emplace(
-                                n->var_name,
+                        declare(
+                                n,
                                 builder->CreateAlloca(
                                         Type::getInt32Ty(context),
                                         nullptr,
-                                        n->var_name + "_ptr"
+                                        n->var_name.str() + "_ptr"
                                 )
                         );
                         if (generateDI) {
                             DILocalVariable *var = dbuilder->createAutoVariable(
                                     lexical_blocks.back(),
-                                    n->var_name,
+                                    n->var_name.str(),
                                     unit,
                                     n->location.line,
                                     getDebugType(Type::getInt32Ty(context))
                             );
                             dbuilder->insertDeclare(
-                                    table.at(n->var_name),
+                                    variable(n).address,
                                     var,
                                     dbuilder->createExpression(),
-                                    DebugLoc::get(
+                                    DILocation::get(
+                                            context,
                                             n->location.line,
                                             0,
                                             lexical_blocks.back()
@@ -298,27 +333,28 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                         break;
                     }
                     case Node::FLOATING: { // float variable
-                        table.emplace(
-                                n->var_name,
+                        declare(
+                                n,
                                 builder->CreateAlloca(
                                         Type::getDoubleTy(context),
                                         nullptr,
-                                        n->var_name + "_ptr"
+                                        n->var_name.str() + "_ptr"
                                 )
                         );
                         if (generateDI) {
                             DILocalVariable *var = dbuilder->createAutoVariable(
                                     lexical_blocks.back(),
-                                    n->var_name,
+                                    n->var_name.str(),
                                     unit,
                                     n->location.line,
                                     getDebugType(Type::getDoubleTy(context))
                             );
                             dbuilder->insertDeclare(
-                                    table.at(n->var_name),
+                                    variable(n).address,
                                     var,
                                     dbuilder->createExpression(),
-                                    DebugLoc::get(
+                                    DILocation::get(
+                                            context,
                                             n->location.line,
                                             0,
                                             lexical_blocks.back()
@@ -329,27 +365,28 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                         break;
                     }
                     case Node::STRING: { // string variable
-                        table.emplace(
-                                n->var_name,
+                        declare(
+                                n,
                                 builder->CreateAlloca(
                                         ArrayType::get(Type::getInt8Ty(context), 256),
                                         nullptr,
-                                        n->var_name + "_ptr")
+                                        n->var_name.str() + "_ptr")
 
                         );
                         if (generateDI) {
                             DILocalVariable *var = dbuilder->createAutoVariable(
                                     lexical_blocks.back(),
-                                    n->var_name,
+                                    n->var_name.str(),
                                     unit,
                                     n->location.line,
                                     getDebugType(ArrayType::get(Type::getInt8Ty(context), 256))
                             );
                             dbuilder->insertDeclare(
-                                    table.at(n->var_name),
+                                    variable(n).address,
                                     var,
                                     dbuilder->createExpression(),
-                                    DebugLoc::get(
+                                    DILocation::get(
+                                            context,
                                             n->location.line,
                                             0,
                                             lexical_blocks.back()
@@ -360,27 +397,28 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                         break;
                     }
                     case Node::BOOL: { // bool variable
-                        table.emplace(
-                                n->var_name,
+                        declare(
+                                n,
                                 builder->CreateAlloca(
                                         Type::getInt1Ty(context),
                                         nullptr,
-                                        n->var_name + "_ptr"
+                                        n->var_name.str() + "_ptr"
                                 )
                         );
                         if (generateDI) {
                             DILocalVariable *var = dbuilder->createAutoVariable(
                                     lexical_blocks.back(),
-                                    n->var_name,
+                                    n->var_name.str(),
                                     unit,
                                     n->location.line,
                                     getDebugType(Type::getInt1Ty(context))
                             );
                             dbuilder->insertDeclare(
-                                    table.at(n->var_name),
+                                    variable(n).address,
                                     var,
                                     dbuilder->createExpression(),
-                                    DebugLoc::get(
+                                    DILocation::get(
+                                            context,
                                             n->location.line,
                                             0,
                                             lexical_blocks.back()
@@ -391,12 +429,12 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                         break;
                     }
                     case Node::USER: // user-type variable
-                        table.emplace(
-                                n->var_name,
+                        declare(
+                                n,
                                 builder->CreateAlloca(
                                         user_types.at(n->user_type)->llvm_type,
                                         nullptr,
-                                        n->var_name + "_ptr"
+                                        n->var_name.str() + "_ptr"
                                 )
                         );
                         break;
@@ -405,30 +443,30 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
             break;
         }
         case Node::INIT: { // create and initialize the variable
-            last_vars.emplace_back(n->var_name);
             switch (n->value_type) {
                 case Node::INTEGER: { // integer variable
-                    table.emplace(
-                            n->var_name,
+                    declare(
+                            n,
                             builder->CreateAlloca(
                                     Type::getInt32Ty(context),
                                     nullptr,
-                                    n->var_name + "_ptr"
+                                    n->var_name.str() + "_ptr"
                             )
                     );
                     if (generateDI) {
                         DILocalVariable *var = dbuilder->createAutoVariable(
                                 lexical_blocks.back(),
-                                n->var_name,
+                                n->var_name.str(),
                                 unit,
                                 n->location.line,
                                 getDebugType(Type::getInt32Ty(context))
                         );
                         dbuilder->insertDeclare(
-                                table.at(n->var_name),
+                                variable(n).address,
                                 var,
                                 dbuilder->createExpression(),
-                                DebugLoc::get(
+                                DILocation::get(
+                                        context,
                                         n->location.line,
                                         0,
                                         lexical_blocks.back()
@@ -439,27 +477,28 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                     break;
                 }
                 case Node::FLOATING: { // float variable
-                    table.emplace(
-                            n->var_name,
+                    declare(
+                            n,
                             builder->CreateAlloca(
                                     Type::getDoubleTy(context),
                                     nullptr,
-                                    n->var_name + "_ptr"
+                                    n->var_name.str() + "_ptr"
                             )
                     );
                     if (generateDI) {
                         DILocalVariable *var = dbuilder->createAutoVariable(
                                 lexical_blocks.back(),
-                                n->var_name,
+                                n->var_name.str(),
                                 unit,
                                 n->location.line,
                                 getDebugType(Type::getDoubleTy(context))
                         );
                         dbuilder->insertDeclare(
-                                table.at(n->var_name),
+                                variable(n).address,
                                 var,
                                 dbuilder->createExpression(),
-                                DebugLoc::get(
+                                DILocation::get(
+                                        context,
                                         n->location.line,
                                         0,
                                         lexical_blocks.back()
@@ -470,27 +509,28 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                     break;
                 }
                 case Node::STRING: { // string variable
-                    table.emplace(
-                            n->var_name,
+                    declare(
+                            n,
                             builder->CreateAlloca(
                                     ArrayType::get(Type::getInt8Ty(context), 256),
                                     nullptr,
-                                    n->var_name + "_ptr")
+                                    n->var_name.str() + "_ptr")
 
                     );
                     if (generateDI) {
                         DILocalVariable *var = dbuilder->createAutoVariable(
                                 lexical_blocks.back(),
-                                n->var_name,
+                                n->var_name.str(),
                                 unit,
                                 n->location.line,
                                 getDebugType(ArrayType::get(Type::getInt8Ty(context), 256))
                         );
                         dbuilder->insertDeclare(
-                                table.at(n->var_name),
+                                variable(n).address,
                                 var,
                                 dbuilder->createExpression(),
-                                DebugLoc::get(
+                                DILocation::get(
+                                        context,
                                         n->location.line,
                                         0,
                                         lexical_blocks.back()
@@ -501,27 +541,28 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                     break;
                 }
                 case Node::BOOL: { // bool variable
-                    table.emplace(
-                            n->var_name,
+                    declare(
+                            n,
                             builder->CreateAlloca(
                                     Type::getInt1Ty(context),
                                     nullptr,
-                                    n->var_name + "_ptr"
+                                    n->var_name.str() + "_ptr"
                             )
                     );
                     if (generateDI) {
                         DILocalVariable *var = dbuilder->createAutoVariable(
                                 lexical_blocks.back(),
-                                n->var_name,
+                                n->var_name.str(),
                                 unit,
                                 n->location.line,
                                 getDebugType(Type::getInt1Ty(context))
                         );
                         dbuilder->insertDeclare(
-                                table.at(n->var_name),
+                                variable(n).address,
                                 var,
                                 dbuilder->createExpression(),
-                                DebugLoc::get(
+                                DILocation::get(
+                                        context,
                                         n->location.line,
                                         0,
                                         lexical_blocks.back()
@@ -532,72 +573,41 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                     break;
                 }
                 case Node::USER: // user-type variable
-                    table.emplace(
-                            n->var_name,
+                    declare(
+                            n,
                             builder->CreateAlloca(
                                     user_types.at(n->user_type)->llvm_type,
                                     nullptr,
-                                    n->var_name + "_ptr"
+                                    n->var_name.str() + "_ptr"
                             )
                     );
                     break;
             }
 
             if (n->o1->value_type == Node::USER && n->o1->kind == Node::VAR_ACCESS) {
-                if (n->value_type != n->o1->value_type || n->user_type != n->o1->user_type) {
-                    error(
-                            n->location.line,
-                            "types of objects '"
-                            + n->var_name
-                            + "' ("
-                            + std::string(
-                                    n->value_type == Node::USER ? (n->user_type) : (n->value_type == Node::INTEGER ? "int" : "float"))
-                            + ") and '"
-                            + n->o1->var_name
-                            + "' ("
-                            + std::string(
-                                    n->o1->value_type == Node::USER ? (n->o1->user_type) : (n->o1->value_type == Node::INTEGER ? "int" : "float"))
-                            + ") does not match!"
-                    );
-                }
-
+                Value *object = variable(n->o1).address;
                 builder->CreateMemCpy(
-                        table.at(n->var_name),
-                        table.at(n->o1->var_name),
-                        module->getDataLayout().getTypeAllocSize(table.at(n->o1->var_name)->getType()),
-                        table.at(n->o1->var_name)->getPointerAlignment(module->getDataLayout())
+                        variable(n).address,
+                        object->getPointerAlignment(module->getDataLayout()),
+                        object,
+                        object->getPointerAlignment(module->getDataLayout()),
+                        module->getDataLayout().getTypeAllocSize(object->getType())
                 );
             } else if (n->o1->value_type == Node::USER && (n->o1->kind == Node::FUNCTION_CALL || n->o1->kind == Node::METHOD_CALL)) {
-                if (n->value_type != n->o1->value_type || n->user_type != n->o1->user_type) {
-                    error(
-                            n->location.line,
-                            "types of objects '"
-                            + n->var_name
-                            + "' ("
-                            + std::string(
-                                    n->value_type == Node::USER ? (n->user_type) : (n->value_type == Node::INTEGER ? "int" : "float"))
-                            + ") and '"
-                            + n->o1->var_name
-                            + "' ("
-                            + std::string(
-                                    n->o1->value_type == Node::USER ? (n->o1->user_type) : (n->o1->value_type == Node::INTEGER ? "int" : "float"))
-                            + ") does not match!"
-                    );
-                }
-
                 generate(n->o1);
                 Value *call = stack.top();
                 stack.pop();
 
                 builder->CreateMemCpy(
-                        table.at(n->var_name),
+                        variable(n).address,
+                        call->getPointerAlignment(module->getDataLayout()),
                         call,
-                        module->getDataLayout().getTypeAllocSize(call->getType()),
-                        call->getPointerAlignment(module->getDataLayout())
+                        call->getPointerAlignment(module->getDataLayout()),
+                        module->getDataLayout().getTypeAllocSize(call->getType())
                 );
             } else {
                 if (n->o1->kind == Node::OBJECT_CONSTRUCT) {
-                    stack.emplace(table.at(n->var_name));
+                    stack.emplace(variable(n).address);
                 }
 
                 generate(n->o1); // generate initial value
@@ -609,35 +619,22 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                 Value *val = stack.top(); // take it from the stack
                 stack.pop(); // erase it from the stack
 
-                if (table.at(n->var_name)->getType() != val->getType()) {
-                    if (table.at(n->var_name)->getType()->isIntegerTy(32) && val->getType()->isDoubleTy()) {
-                        Value *buf = val;
-                        val = builder->CreateFPToSI(buf, Type::getInt32Ty(context));
-                    } else if (table.at(n->var_name)->getType()->isDoubleTy() && val->getType()->isIntegerTy(32)) {
-                        Value *buf = val;
-                        val = builder->CreateSIToFP(buf, Type::getDoubleTy(context));
-                    } else if (table.at(n->var_name)->getType()->isIntegerTy(1) && val->getType()->isDoubleTy()) {
-                        Value *buf = val;
-                        val = builder->CreateFPToUI(buf, Type::getInt1Ty(context));
-                    } else if (table.at(n->var_name)->getType()->isDoubleTy() && val->getType()->isIntegerTy(1)) {
-                        Value *buf = val;
-                        val = builder->CreateUIToFP(buf, Type::getDoubleTy(context));
-                    }
-                }
+                val = convert(val, n->value_type);
 
-                if (table.at(n->var_name)->getType() == PointerType::get(ArrayType::get(Type::getInt8Ty(context), 256), 0)) {
+                if (n->storage == Node::STRING_BUFFER) {
                     Value *arr = builder->CreateBitCast(
-                            table.at(n->var_name),
+                            variable(n).address,
                             Type::getInt8PtrTy(context)
                     );
                     builder->CreateMemCpy(
                             arr,
+                            module->getDataLayout().getABITypeAlign(Type::getInt8Ty(context)),
                             val,
-                            255,
-                            module->getDataLayout().getABITypeAlignment(Type::getInt8Ty(context))
+                            module->getDataLayout().getABITypeAlign(Type::getInt8Ty(context)),
+                            255
                     );
                 } else {
-                    builder->CreateStore(val, table.at(n->var_name));
+                    builder->CreateStore(val, variable(n).address);
                 }
             }
             break;
@@ -647,62 +644,48 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                 emitLocation(n);
             }
 
-            table.erase(n->var_name); // erase pointer from the table
-            last_vars.erase(std::find(std::cbegin(last_vars), std::cend(last_vars), n->var_name));
-            break;
+            break; // the Resolver has unbound the name
         }
         case Node::VAR_ACCESS: { // push value of the variable to the stack
             if (generateDI) {
                 emitLocation(n);
             }
 
-            Type *type;
-
-            auto ptr = table.at(n->var_name);
-            /*for (auto &&user_type : user_types) {
-                auto iter = user_type.second->properties.find(n->var_name);
-                if (iter != std::end(user_type.second->properties)) {
-                    ptr = builder->CreateGEP(
-                            user_type.second->llvm_type,
-                            builder->CreateLoad(table.at("this")),
-                            {
-                                    ConstantInt::get(Type::getInt32Ty(context), 0),
-                                    ConstantInt::get(
-                                            Type::getInt32Ty(context),
-                                            static_cast<uint64_t>(std::distance(std::begin(user_type.second->properties), iter))
-                                    )
-                            },
-                            n->var_name
-                    );
+            Value *ptr = variable(n).address;
+            switch (n->storage) {
+                case Node::SCALAR: {
+                    Type *type;
+                    switch (n->value_type) {
+                        case Node::FLOATING:
+                            type = Type::getDoubleTy(context);
+                            break;
+                        case Node::BOOL:
+                            type = Type::getInt1Ty(context);
+                            break;
+                        default:
+                            type = Type::getInt32Ty(context);
+                    }
+                    stack.emplace(builder->CreateLoad(type, ptr, n->var_name.str()));
+                    break;
                 }
-            }*/
-
-            if (table.at(n->var_name)->getType() == Type::getInt32PtrTy(context)) {
-                type = Type::getInt32Ty(context);
-            } else if (table.at(n->var_name)->getType() == Type::getDoublePtrTy(context)) {
-                type = Type::getDoubleTy(context);
-            } else if (table.at(n->var_name)->getType() == Type::getInt1PtrTy(context)) {
-                type = Type::getInt1Ty(context);
-            } else if (table.at(n->var_name)->getType() == PointerType::get(ArrayType::get(Type::getInt8Ty(context), 256), 0)) {
-                stack.emplace(
-                        builder->CreateGEP(
-                                table.at(n->var_name), {
-                                        ConstantInt::get(Type::getInt32Ty(context), 0),
-                                        ConstantInt::get(Type::getInt32Ty(context), 0)
-                                },
-                                n->var_name
-                        )
-                );
-                break;
-            } else if (table.at(n->var_name)->getType() == PointerType::get(PointerType::get(Type::getInt8Ty(context), 0), 0)) {
-                type = PointerType::get(Type::getInt8Ty(context), 0);
-            }
-            else {
-                stack.emplace(table.at(n->var_name));
-                break;
+                case Node::STRING_BUFFER:
+                    stack.emplace(
+                            builder->CreateGEP(
+                                    ptr->getType()->getPointerElementType(),
+                                    ptr, {
+                                            ConstantInt::get(Type::getInt32Ty(context), 0),
+                                            ConstantInt::get(Type::getInt32Ty(context), 0)
+                                    },
+                                    n->var_name.str()
+                            )
+                    );
+                    break;
+                case Node::STRING_POINTER:
+                    stack.emplace(builder->CreateLoad(Type::getInt8PtrTy(context), ptr, n->var_name.str()));
+                    break;
+                default: // objects and arrays are used where they are
+                    stack.emplace(ptr);
             }
-
-            stack.emplace(builder->CreateLoad(type, ptr, n->var_name));
             break;
         }
         case Node::FUNC_OBJ_PROPERTY_ACCESS: {
@@ -712,37 +695,25 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
 
             Value *ptr;
 
-            auto user_type = user_types.at(n->user_type);
-            auto iter = user_type->properties.find(n->property_name);
-            int property_access = iter->second; //user_type.second.second.at(static_cast<unsigned>(std::distance(std::begin(user_type.second.first), iter)));
-
-            if (property_access == Node::PRIVATE || property_access == Node::PROTECTED) {
-                error(n->location.line, "property '" + n->property_name + "' of object '" + n->var_name + "' is private");
-            }
-
             generate(n->o1);
             Value* src = stack.top();
             stack.pop();
 
-            while (cast<PointerType>(src->getType())->getElementType()->isPointerTy()) {
-                Value *temp = builder->CreateLoad(src);
+            while (src->getType()->getPointerElementType()->isPointerTy()) {
+                Value *temp = builder->CreateLoad(src->getType()->getPointerElementType(), src);
                 src = temp;
             }
 
-            if (iter != std::end(user_type->properties)) {
-                ptr = builder->CreateGEP(
-                        src,
-                        {
-                                ConstantInt::get(Type::getInt32Ty(context), 0),
-                                ConstantInt::get(
-                                        Type::getInt32Ty(context),
-                                        static_cast<uint64_t>(std::distance(std::begin(user_type->properties), iter))
-                                )
-                        },
-                        n->var_name + "::" + n->property_name
-                );
-            }
-            stack.emplace(builder->CreateLoad(ptr, n->property_name));
+            ptr = builder->CreateGEP(
+                    src->getType()->getPointerElementType(),
+                    src,
+                    {
+                            ConstantInt::get(Type::getInt32Ty(context), 0),
+                            ConstantInt::get(Type::getInt32Ty(context), n->resolved.field)
+                    },
+                    n->var_name.str() + "::" + n->property_name.str()
+            );
+            stack.emplace(builder->CreateLoad(ptr->getType()->getPointerElementType(), ptr, n->property_name.str()));
             break;
         }
         case Node::PROPERTY_ACCESS: {
@@ -751,34 +722,23 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
             }
 
             Value *ptr;
-            auto user_type = user_types.at(n->user_type);
-            auto iter = user_type->properties.find(n->property_name);
-            int property_access = iter->second;
 
-            if (n->var_name != "this" && (property_access == Node::PRIVATE || property_access == Node::PROTECTED)) {
-                error(n->location.line, "property '" + n->property_name + "' of object '" + n->var_name + "' is private");
-            }
-
-            Value* src = table.at(n->var_name);
-            while (cast<PointerType>(src->getType())->getElementType()->isPointerTy()) {
-                Value *temp = builder->CreateLoad(src);
+            Value* src = variable(n).address;
+            while (src->getType()->getPointerElementType()->isPointerTy()) {
+                Value *temp = builder->CreateLoad(src->getType()->getPointerElementType(), src);
                 src = temp;
             }
 
-            if (iter != std::end(user_type->properties)) {
-                ptr = builder->CreateGEP(
-                        src,
-                        {
-                                ConstantInt::get(Type::getInt32Ty(context), 0),
-                                ConstantInt::get(
-                                        Type::getInt32Ty(context),
-                                        static_cast<uint64_t>(std::distance(std::begin(user_type->properties), iter))
-                                )
-                        },
-                        n->var_name + "::" + n->property_name
-                );
-            }
-            stack.emplace(builder->CreateLoad(ptr, n->property_name));
+            ptr = builder->CreateGEP(
+                    src->getType()->getPointerElementType(),
+                    src,
+                    {
+                            ConstantInt::get(Type::getInt32Ty(context), 0),
+                            ConstantInt::get(Type::getInt32Ty(context), n->resolved.field)
+                    },
+                    n->var_name.str() + "::" + n->property_name.str()
+            );
+            stack.emplace(builder->CreateLoad(ptr->getType()->getPointerElementType(), ptr, n->property_name.str()));
             break;
         }
         case Node::FUNCTION_CALL: { // generate function's call
@@ -788,16 +748,6 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
 
             Function *callee = functions.at(n->var_name); // get the function's prototype
 
-            if (callee->arg_size() != n->func_call_args.size()) { // check number of arguments in prototype and in calling
-                error(
-                        n->location.line,
-                        "invalid number arguments (" +
-                        std::to_string(n->func_call_args.size()) +
-                        ") , expected " +
-                        std::to_string(callee->arg_size())
-                );
-            }
-
             std::vector<Value *> args; // generate values of arguments
             for (auto &&arg : n->func_call_args) {
                 generate(arg); // generate value
@@ -809,7 +759,7 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
             if (callee->getReturnType() == Type::getVoidTy(context)) {
                 call = builder->CreateCall(callee, args); // LLVM forbids give name to call of void function
             } else {
-                call = builder->CreateCall(callee, args, n->var_name+"_call");
+                call = builder->CreateCall(callee, args, n->var_name.str()+"_call");
             }
 
             stack.emplace(call); // push call to the stack
@@ -820,38 +770,15 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                 emitLocation(n);
             }
 
-            auto object = table.at(n->var_name);
-            while (object->getType()->isPointerTy()) {
-                Value *temp = builder->CreateLoad(object);
-                object = temp;
-            }
-
-            std::shared_ptr<Method> method = nullptr;
-            for (auto &&user_type : user_types) {
-                if (user_type.second->llvm_type == static_cast<StructType *>(object->getType())) {
-                    method = user_type.second->methods.at(n->property_name);
-                }
-            }
-            Function *callee = method->prototype; // get the function's prototype
+            generate(n->o1); // the object
+            Value *self = stack.top();
+            stack.pop();
 
-            if (n->var_name != "this" && (method->access_type == Node::PRIVATE || method->access_type == Node::PROTECTED)) {
-                error(n->location.line, "method '" + n->property_name + "' of object '" + n->var_name + "' is private");
-            }
-
-            if (callee->arg_size() != n->func_call_args.size() && callee->arg_size()-n->func_call_args.size()>1) { // check number of arguments in prototype and in calling
-                error(
-                        n->location.line,
-                        "invalid number arguments (" +
-                        std::to_string(n->func_call_args.size()) +
-                        "), expected " +
-                        std::to_string(callee->arg_size())
-                );
-            }
+            Function *callee = class_of(self)->method(n->property_name).prototype; // get the function's prototype
 
             std::vector<Value *> args; // generate values of arguments
-            Value *self = table.at(n->var_name);
-            while (cast<PointerType>(self->getType())->getElementType()->isPointerTy()) {
-                Value *temp = builder->CreateLoad(self);
+            while (self->getType()->getPointerElementType()->isPointerTy()) {
+                Value *temp = builder->CreateLoad(self->getType()->getPointerElementType(), self);
                 self = temp;
             }
             args.emplace_back(self);
@@ -866,7 +793,7 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
             if (callee->getReturnType() == Type::getVoidTy(context)) {
                 call = builder->CreateCall(callee, args); // LLVM forbids give name to call of void function
             } else {
-                call = builder->CreateCall(callee, args, n->var_name+"::"+n->property_name+"_call");
+                call = builder->CreateCall(callee, args, n->var_name.str()+"::"+n->property_name.str()+"_call");
             }
 
             stack.emplace(call); // push call to the stack
@@ -881,26 +808,11 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
             Value *obj = stack.top();
             stack.pop();
 
-            auto method = user_types.at(table.at(n->var_name)->getType()->getStructName())->methods.at(n->property_name);
-            Function *callee = method->prototype; // get the function's prototype
-
-            if (n->var_name != "this" && (method->access_type == Node::PRIVATE || method->access_type == Node::PROTECTED)) {
-                error(n->location.line, "method '" + n->property_name + "' of object returned by function '" + n->var_name + "' is private");
-            }
-
-            if (callee->arg_size() != n->func_call_args.size() && callee->arg_size()-n->func_call_args.size()>1) { // check number of arguments in prototype and in calling
-                error(
-                        n->location.line,
-                        "invalid number arguments (" +
-                        std::to_string(n->func_call_args.size()) +
-                        "), expected " +
-                        std::to_string(callee->arg_size())
-                );
-            }
+            Function *callee = class_of(obj)->method(n->property_name).prototype; // get the function's prototype
 
             std::vector<Value *> args; // generate values of arguments
-            while (cast<PointerType>(obj->getType())->getElementType()->isPointerTy()) {
-                Value *temp = builder->CreateLoad(obj);
+            while (obj->getType()->getPointerElementType()->isPointerTy()) {
+                Value *temp = builder->CreateLoad(obj->getType()->getPointerElementType(), obj);
                 obj = temp;
             }
             args.emplace_back(obj);
@@ -915,7 +827,7 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
             if (callee->getReturnType() == Type::getVoidTy(context)) {
                 call = builder->CreateCall(callee, args); // LLVM forbids give name to call of void function
             } else {
-                call = builder->CreateCall(callee, args, n->var_name+"::"+n->property_name+"_call");
+                call = builder->CreateCall(callee, args, n->var_name.str()+"::"+n->property_name.str()+"_call");
             }
 
             stack.emplace(call); // push call to the stack
@@ -926,18 +838,7 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                 emitLocation(n);
             }
 
-            auto method = user_types.at(n->var_name)->methods.at(n->var_name);
-            Function *callee = method->prototype; // get the function's prototype
-
-            if (callee->arg_size() != n->func_call_args.size() && callee->arg_size()-n->func_call_args.size()>1) { // check number of arguments in prototype and in calling
-                error(
-                        n->location.line,
-                        "invalid number arguments (" +
-                        std::to_string(n->func_call_args.size()) +
-                        "), expected " +
-                        std::to_string(callee->arg_size())
-                );
-            }
+            Function *callee = user_types.at(n->var_name)->method(n->var_name).prototype; // get the function's prototype
 
             std::vector<Value *> args; // generate values of arguments
             args.emplace_back(stack.top());
@@ -952,7 +853,7 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
             if (callee->getReturnType() == Type::getVoidTy(context)) {
                 call = builder->CreateCall(callee, args); // LLVM forbids give name to call of void function
             } else {
-                call = builder->CreateCall(callee, args, n->var_name+"_call");
+                call = builder->CreateCall(callee, args, n->var_name.str()+"_call");
             }
 
             stack.emplace(call); // push call to the stack
@@ -972,21 +873,21 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
             }
 
             int64_t array_size = 0;
-            if (llvm::ConstantInt *CI = dyn_cast<llvm::ConstantInt>(array_sizes.at(n->var_name))) {
+            if (llvm::ConstantInt *CI = dyn_cast<llvm::ConstantInt>(variable(n).elements)) {
                 if (CI->getBitWidth() <= 32) {
                     array_size = CI->getSExtValue();
                 }
             }
 
             if (element_num >= array_size && array_size != 0) {
-                error(n->location.line, "array '" + n->var_name + "' has only " + std::to_string(array_size) + " elements");
+                error(n->location.line, "array '" + n->var_name.str() + "' has only " + std::to_string(array_size) + " elements");
             }
 
 
             // runtime check of accessing element
             Value *cond = builder->CreateICmpSGE(
                     element_val,
-                    array_sizes.at(n->var_name)
+                    variable(n).elements
             );
             Function *parent = builder->GetInsertBlock()->getParent();
             BasicBlock *thenBlock = BasicBlock::Create(context, "then", parent); // create blocks
@@ -1000,16 +901,16 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                 use_io();
             }
             std::vector<Value*> args;
-            args.emplace_back(table.at("str_out_format"));
+            args.emplace_back(str_out_format);
             args.emplace_back(
                     builder->CreateGlobalStringPtr(
-                            "Runtime error: accessing unallocated element of array '" + n->var_name + "'"
+                            "Runtime error: accessing unallocated element of array '" + n->var_name.str() + "'"
                     )
             );
             builder->CreateCall(printf, args); // call prinf
             std::vector<Type *> exitArgs = { Type::getInt32Ty(context) };
             FunctionType *exitType = FunctionType::get(Type::getVoidTy(context), exitArgs, false);
-            Constant *exit = module->getOrInsertFunction("exit", exitType);
+            FunctionCallee exit = module->getOrInsertFunction("exit", exitType);
             builder->CreateCall(exit, ConstantInt::get(Type::getInt32Ty(context), 1));
 
             builder->CreateBr(mergeBlock);
@@ -1020,39 +921,43 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
             builder->SetInsertPoint(mergeBlock); // set insert point to block after the condition
 
 
-            Value *arr_ptr = table.at(n->var_name); // get array's pointer
+            Value *arr_ptr = variable(n).address; // get array's pointer
 
-            ArrayType* arr_type = cast<ArrayType>(cast<PointerType>(arr_ptr->getType())->getElementType());
+            ArrayType* arr_type = cast<ArrayType>(arr_ptr->getType()->getPointerElementType());
             if (arr_type->getElementType() == ArrayType::get(Type::getInt8Ty(context), 256)) { // array of strings
                 stack.emplace(
                         builder->CreateGEP(
+                                arr_type->getElementType(),
                                 builder->CreateGEP(
+                                        arr_ptr->getType()->getPointerElementType(),
                                         arr_ptr,
                                         {
                                                 ConstantInt::get(Type::getInt32Ty(context), 0),
                                                 element_val
                                         },
-                                        n->var_name
+                                        n->var_name.str()
                                 ),
                                 {
                                         ConstantInt::get(Type::getInt32Ty(context), 0),
                                         ConstantInt::get(Type::getInt32Ty(context), 0)
                                 },
-                                n->var_name
+                                n->var_name.str()
                         )
                 );
             } else {
                 stack.emplace(
                         builder->CreateLoad(
+                                arr_type->getElementType(),
                                 builder->CreateGEP( // get element's pointer
+                                        arr_ptr->getType()->getPointerElementType(),
                                         arr_ptr,
                                         {
                                                 ConstantInt::get(Type::getInt32Ty(context), 0),
                                                 element_val
                                         },
-                                        n->var_name
+                                        n->var_name.str()
                                 ),
-                                n->var_name
+                                n->var_name.str()
                         )
                 );
             }
@@ -1065,9 +970,13 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
 
             switch (n->value_type) {
                 case Node::STRING: // str constant
-                    stack.emplace(builder->CreateGlobalStringPtr(n->str_val));
+                    stack.emplace(builder->CreateGlobalStringPtr(StringRef(n->str_val.data(), n->str_val.size())));
                     break;
                 case Node::INTEGER: { // integer constant
+                    if (n->int_val > std::numeric_limits<int32_t>::max() || n->int_val < std::numeric_limits<int32_t>::min()) {
+                        error(n->location.line, "integer constant " + std::to_string(n->int_val) + " does not fit in 32 bits");
+                    }
+
                     stack.emplace(ConstantInt::get(Type::getInt32Ty(context), static_cast<uint64_t>(n->int_val), true));
                     break;
                 }
@@ -1097,7 +1006,7 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
 
             // strings concatenation
             if (left->getType() == Type::getInt8PtrTy(context) && right->getType() == Type::getInt8PtrTy(context)) {
-                Constant *strcat = module->getOrInsertFunction(
+                FunctionCallee strcat = module->getOrInsertFunction(
                         "strcat",
                         FunctionType::get(
                                 Type::getInt32Ty(context),
@@ -1114,7 +1023,13 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                         ),
                         Type::getInt8PtrTy(context)
                 );
-                builder->CreateMemCpy(new_str, left, 255, module->getDataLayout().getABITypeAlignment(Type::getInt8Ty(context)));
+                builder->CreateMemCpy(
+                        new_str,
+                        module->getDataLayout().getABITypeAlign(Type::getInt8Ty(context)),
+                        left,
+                        module->getDataLayout().getABITypeAlign(Type::getInt8Ty(context)),
+                        255
+                );
                 builder->CreateCall(strcat, { new_str, right });
                 stack.emplace(new_str);
             }
@@ -1286,7 +1201,7 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
 
             // compare strings
             if (left->getType() == Type::getInt8PtrTy(context) && right->getType() == Type::getInt8PtrTy(context)) {
-                Constant *strcmp = module->getOrInsertFunction(
+                FunctionCallee strcmp = module->getOrInsertFunction(
                         "strcmp",
                         FunctionType::get(
                                 Type::getInt32Ty(context),
@@ -1332,7 +1247,7 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
 
             // compare strings
             if (left->getType() == Type::getInt8PtrTy(context) && right->getType() == Type::getInt8PtrTy(context)) {
-                Constant *strcmp = module->getOrInsertFunction(
+                FunctionCallee strcmp = module->getOrInsertFunction(
                         "strcmp",
                         FunctionType::get(
                                 Type::getInt32Ty(context),
@@ -1378,7 +1293,7 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
 
             // compare strings
             if (left->getType() == Type::getInt8PtrTy(context) && right->getType() == Type::getInt8PtrTy(context)) {
-                Constant *strcmp = module->getOrInsertFunction(
+                FunctionCallee strcmp = module->getOrInsertFunction(
                         "strcmp",
                         FunctionType::get(
                                 Type::getInt32Ty(context),
@@ -1424,7 +1339,7 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
 
             // compare strings
             if (left->getType() == Type::getInt8PtrTy(context) && right->getType() == Type::getInt8PtrTy(context)) {
-                Constant *strcmp = module->getOrInsertFunction(
+                FunctionCallee strcmp = module->getOrInsertFunction(
                         "strcmp",
                         FunctionType::get(
                                 Type::getInt32Ty(context),
@@ -1469,7 +1384,7 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
 
             // compare strings
             if (left->getType() == Type::getInt8PtrTy(context) && right->getType() == Type::getInt8PtrTy(context)) {
-                Constant *strcmp = module->getOrInsertFunction(
+                FunctionCallee strcmp = module->getOrInsertFunction(
                         "strcmp",
                         FunctionType::get(
                                 Type::getInt32Ty(context),
@@ -1515,7 +1430,7 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
 
             // compare strings
             if (left->getType() == Type::getInt8PtrTy(context) && right->getType() == Type::getInt8PtrTy(context)) {
-                Constant *strcmp = module->getOrInsertFunction(
+                FunctionCallee strcmp = module->getOrInsertFunction(
                         "strcmp",
                         FunctionType::get(
                                 Type::getInt32Ty(context),
@@ -1552,58 +1467,29 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
             }
 
             if (n->o1->value_type == Node::USER && n->o1->kind == Node::VAR_ACCESS) {
-                if (n->value_type != n->o1->value_type || n->user_type != n->o1->user_type) {
-                    error(n->location.line,
-                          "types of objects '"
-                          + n->var_name
-                          + "' ("
-                          + std::string(
-                                  n->value_type == Node::USER ? (n->user_type) : (n->value_type == Node::INTEGER ? "int" : "float"))
-                          + ") and '"
-                          + n->o1->var_name
-                          + "' ("
-                          + std::string(
-                                  n->o1->value_type == Node::USER ? (n->o1->user_type) : (n->o1->value_type == Node::INTEGER ? "int" : "float"))
-                          + ") does not match!"
-                    );
-                }
-
+                Value *object = variable(n->o1).address;
                 builder->CreateMemCpy(
-                        table.at(n->var_name),
-                        table.at(n->o1->var_name),
-                        module->getDataLayout().getTypeAllocSize(table.at(n->o1->var_name)->getType()),
-                        table.at(n->o1->var_name)->getPointerAlignment(module->getDataLayout())
+                        variable(n).address,
+                        object->getPointerAlignment(module->getDataLayout()),
+                        object,
+                        object->getPointerAlignment(module->getDataLayout()),
+                        module->getDataLayout().getTypeAllocSize(object->getType())
                 );
             } else if (n->o1->value_type == Node::USER && (n->o1->kind == Node::FUNCTION_CALL || n->o1->kind == Node::METHOD_CALL)) {
-                if (n->value_type != n->o1->value_type || n->user_type != n->o1->user_type) {
-                    error(n->location.line,
-                          "types of objects '"
-                          + n->var_name
-                          + "' ("
-                          + std::string(
-                                  n->value_type == Node::USER ? (n->user_type) : (n->value_type == Node::INTEGER ? "int" : "float"))
-                          + ") and '"
-                          + n->o1->var_name
-                          + "' ("
-                          + std::string(
-                                  n->o1->value_type == Node::USER ? (n->o1->user_type) : (n->o1->value_type == Node::INTEGER ? "int" : "float"))
-                          + ") does not match!"
-                    );
-                }
-
                 generate(n->o1);
                 Value *call = stack.top();
                 stack.pop();
 
                 builder->CreateMemCpy(
-                        table.at(n->var_name),
+                        variable(n).address,
+                        call->getPointerAlignment(module->getDataLayout()),
                         call,
-                        module->getDataLayout().getTypeAllocSize(call->getType()),
-                        call->getPointerAlignment(module->getDataLayout())
+                        call->getPointerAlignment(module->getDataLayout()),
+                        module->getDataLayout().getTypeAllocSize(call->getType())
                 );
             } else {
                 if (n->o1->kind == Node::OBJECT_CONSTRUCT) {
-                    stack.emplace(table.at(n->var_name));
+                    stack.emplace(variable(n).address);
                 }
 
                 generate(n->o1); // generate new value
@@ -1622,7 +1508,6 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
 
 
                     // get number of elements in array
-                    bool constant = false;
                     int64_t element_num = 0;
                     if (llvm::ConstantInt *CI = dyn_cast<llvm::ConstantInt>(element_val)) {
                         if (CI->getBitWidth() <= 32) {
@@ -1632,7 +1517,7 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                         Value *cond = builder->CreateOr(
                                 builder->CreateICmpSGE(
                                         element_val,
-                                        array_sizes.at(n->var_name)
+                                        variable(n).elements
                                 ),
                                 builder->CreateICmpSLT(
                                         element_val,
@@ -1651,16 +1536,16 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                             use_io();
                         }
                         std::vector<Value *> args;
-                        args.emplace_back(table.at("str_out_format"));
+                        args.emplace_back(str_out_format);
                         args.emplace_back(
                                 builder->CreateGlobalStringPtr(
-                                        "Runtime error: accessing unallocated element of array '" + n->var_name + "'"
+                                        "Runtime error: accessing unallocated element of array '" + n->var_name.str() + "'"
                                 )
                         );
                         builder->CreateCall(printf, args); // call prinf
                         std::vector<Type *> exitArgs = {Type::getInt32Ty(context)};
                         FunctionType *exitType = FunctionType::get(Type::getVoidTy(context), exitArgs, false);
-                        Constant *exit = module->getOrInsertFunction("exit", exitType);
+                        FunctionCallee exit = module->getOrInsertFunction("exit", exitType);
                         builder->CreateCall(exit, ConstantInt::get(Type::getInt32Ty(context), 1));
 
                         builder->CreateBr(mergeBlock);
@@ -1672,18 +1557,18 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                     }
 
                     int64_t array_size = 0;
-                    if (llvm::ConstantInt *CI = dyn_cast<llvm::ConstantInt>(array_sizes.at(n->var_name))) {
+                    if (llvm::ConstantInt *CI = dyn_cast<llvm::ConstantInt>(variable(n).elements)) {
                         if (CI->getBitWidth() <= 32) {
                             array_size = CI->getSExtValue();
                             if (element_num >= array_size) { // number of array's elements and accessing elemnt are constant
-                                error(n->location.line, "array '" + n->var_name + "' has only " + std::to_string(array_size) + " elements");
+                                error(n->location.line, "array '" + n->var_name.str() + "' has only " + std::to_string(array_size) + " elements");
                             }
                         }
                     } else { // array of non-constant number of items
                         // runtime check of accessing element
                         Value *cond = builder->CreateICmpSGE(
                                 element_val,
-                                array_sizes.at(n->var_name)
+                                variable(n).elements
                         );
                         Function *parent = builder->GetInsertBlock()->getParent();
                         BasicBlock *thenBlock = BasicBlock::Create(context, "then", parent); // create blocks
@@ -1697,16 +1582,16 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                             use_io();
                         }
                         std::vector<Value *> args;
-                        args.emplace_back(table.at("str_out_format"));
+                        args.emplace_back(str_out_format);
                         args.emplace_back(
                                 builder->CreateGlobalStringPtr(
-                                        "Runtime error: accessing unallocated element of array '" + n->var_name + "'"
+                                        "Runtime error: accessing unallocated element of array '" + n->var_name.str() + "'"
                                 )
                         );
                         builder->CreateCall(printf, args); // call prinf
                         std::vector<Type *> exitArgs = {Type::getInt32Ty(context)};
                         FunctionType *exitType = FunctionType::get(Type::getVoidTy(context), exitArgs, false);
-                        Constant *exit = module->getOrInsertFunction("exit", exitType);
+                        FunctionCallee exit = module->getOrInsertFunction("exit", exitType);
                         builder->CreateCall(exit, ConstantInt::get(Type::getInt32Ty(context), 1));
 
                         builder->CreateBr(mergeBlock);
@@ -1718,14 +1603,15 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                     }
 
                     // all is ok
-                    Value *arr_ptr = table.at(n->var_name); // get array's pointer
+                    Value *arr_ptr = variable(n).address; // get array's pointer
                     Value *el_ptr = builder->CreateGEP( // get element's pointer
+                            arr_ptr->getType()->getPointerElementType(),
                             arr_ptr,
                             {
                                     ConstantInt::get(Type::getInt32Ty(context), 0),
                                     element_val
                             },
-                            n->var_name
+                            n->var_name.str()
                     );
 
                     if (el_ptr->getType() != val->getType()) {
@@ -1746,9 +1632,10 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                         );
                         builder->CreateMemCpy(
                                 arr,
+                                module->getDataLayout().getABITypeAlign(Type::getInt8Ty(context)),
                                 val,
-                                255,
-                                module->getDataLayout().getABITypeAlignment(Type::getInt8Ty(context))
+                                module->getDataLayout().getABITypeAlign(Type::getInt8Ty(context)),
+                                255
                         );
                     } else {
                         builder->CreateStore(val, el_ptr); // update value of variable
@@ -1756,39 +1643,22 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
 
                 } else if (!n->property_name.empty()) { // change value of object's property
                     Value *property_ptr;
-                    Value *temp = table.at(n->var_name);
-                    while (temp->getType()->isPointerTy()) {
-                        Value *_temp = builder->CreateLoad(temp);
-                        temp = _temp;
-                    }
-
-                    auto user_type = user_types.at(temp->getType()->getStructName().str());
-                    auto iter = user_type->properties.find(n->property_name);
-                    int property_access = iter->second;
 
-                    if (n->var_name != "this" && (property_access == Node::PRIVATE || property_access == Node::PROTECTED)) {
-                        error(n->location.line, "property '" + n->property_name + "' of object '" + n->var_name + "' is private");
-                    }
-
-                    Value* src = table.at(n->var_name);
-                    while (cast<PointerType>(src->getType())->getElementType()->isPointerTy()) {
-                        Value *_temp = builder->CreateLoad(src);
+                    Value* src = variable(n).address;
+                    while (src->getType()->getPointerElementType()->isPointerTy()) {
+                        Value *_temp = builder->CreateLoad(src->getType()->getPointerElementType(), src);
                         src = _temp;
                     }
 
-                    if (iter != std::end(user_type->properties)) {
-                        property_ptr = builder->CreateGEP(
-                                src,
-                                {
-                                        ConstantInt::get(Type::getInt32Ty(context), 0),
-                                        ConstantInt::get(
-                                                Type::getInt32Ty(context),
-                                                static_cast<uint64_t>(std::distance(std::begin(user_type->properties), iter))
-                                        )
-                                },
-                                n->var_name + "::" + n->property_name
-                        );
-                    }
+                    property_ptr = builder->CreateGEP(
+                            src->getType()->getPointerElementType(),
+                            src,
+                            {
+                                    ConstantInt::get(Type::getInt32Ty(context), 0),
+                                    ConstantInt::get(Type::getInt32Ty(context), n->resolved.field)
+                            },
+                            n->var_name.str() + "::" + n->property_name.str()
+                    );
 
                     /*if (el_ptr->getType() != val->getType()) {
                         if (el_ptr->getType() == Type::getInt32PtrTy(context) && val->getType()->isDoubleTy()) {
@@ -1802,51 +1672,22 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                     }*/
                     builder->CreateStore(val, property_ptr); // update value of variable
                 } else {
-                    if (table.at(n->var_name)->getType() != val->getType()) {
-                        if (table.at(n->var_name)->getType() == Type::getInt32PtrTy(context) &&
-                            val->getType()->isDoubleTy()) {
-                            Value *buf = val;
-                            val = builder->CreateFPToSI(buf, Type::getInt32Ty(context));
-                        } else if (table.at(n->var_name)->getType() == Type::getDoublePtrTy(context) &&
-                                   val->getType()->isIntegerTy(32)) {
-                            Value *buf = val;
-                            val = builder->CreateSIToFP(buf, Type::getDoubleTy(context));
-                        }
-                    }
-
-                    auto ptr = table.at(n->var_name);
+                    val = convert(val, n->value_type);
 
-                    for (auto &&user_type : user_types) {
-                        auto iter = user_type.second->properties.find(n->var_name);
-                        if (iter != std::end(user_type.second->properties)) {
-                            ptr = builder->CreateGEP(
-                                    user_type.second->llvm_type,
-                                    builder->CreateLoad(table.at("this")),
-                                    {
-                                            ConstantInt::get(Type::getInt32Ty(context), 0),
-                                            ConstantInt::get(
-                                                    Type::getInt32Ty(context),
-                                                    static_cast<uint64_t>(std::distance(std::begin(user_type.second->properties), iter))
-                                            )
-                                    },
-                                    n->var_name
-                            );
-                        }
-                    }
-
-                    if (table.at(n->var_name)->getType() == PointerType::get(ArrayType::get(Type::getInt8Ty(context), 256), 0)) {
+                    if (n->storage == Node::STRING_BUFFER) {
                         Value *arr = builder->CreateBitCast(
-                                table.at(n->var_name),
+                                variable(n).address,
                                 Type::getInt8PtrTy(context)
                         );
                         builder->CreateMemCpy(
                                 arr,
+                                module->getDataLayout().getABITypeAlign(Type::getInt8Ty(context)),
                                 val,
-                                255,
-                                module->getDataLayout().getABITypeAlignment(Type::getInt8Ty(context))
+                                module->getDataLayout().getABITypeAlign(Type::getInt8Ty(context)),
+                                255
                         );
                     } else {
-                        builder->CreateStore(val, table.at(n->var_name)); // update value of variable
+                        builder->CreateStore(val, variable(n).address); // update value of variable
                     }
                 }
             }
@@ -1858,185 +1699,12 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
                 emitLocation(n);
             }
 
-            std::vector<Type *> properties_types;
-            std::vector<std::string> properties_names;
-            std::vector<int> properties_access;
-            for (auto &&defProperty : n->class_def_properties) { // generate properties first
-                if (defProperty.second.second->kind == Node::VAR_DEF) {
-                    properties_names.emplace_back(defProperty.first);
-                    properties_access.emplace_back(defProperty.second.first);
-                    switch (defProperty.second.second->value_type) {
-                        case Node::INTEGER:
-                            properties_types.emplace_back(Type::getInt32Ty(context));
-                            break;
-                        case Node::FLOATING:
-                            properties_types.emplace_back(Type::getDoubleTy(context));
-                            break;
-                        case Node::STRING:
-                            properties_types.emplace_back(Type::getInt8PtrTy(context));
-                            break;
-                        case Node::BOOL:
-                            properties_types.emplace_back(Type::getInt1Ty(context));
-                            break;
-                    }
-                }
-            }
-
-            StructType* class_type = StructType::create(context, n->var_name);
-            class_type->setName(n->var_name);
-            class_type->setBody(properties_types);
-
-            auto class_prototype = std::make_shared<ClassDefinition>(n->var_name, class_type);
-            for (unsigned i = 0; i != properties_names.size(); i++) {
-                class_prototype->properties.emplace(properties_names.at(i), properties_access.at(i));
-            }
-            user_types.emplace(n->var_name, class_prototype);
-
-            for (auto &&defProperty : n->class_def_methods) { // then, generate methods
-                if (defProperty.second.second->kind == Node::FUNCTION_DEFINE) {
-                    FunctionType *type;
-
-                    // generate arguments
-                    std::vector<Type *> args_types;
-                    std::vector<std::string> args_names;
-
-                    args_types.emplace_back(PointerType::get(class_type, 0));
-                    args_names.emplace_back("this");
-
-                    for (auto &iterator : defProperty.second.second->o1->func_def_args) {
-                        switch (iterator.second->value_type) {
-                            case Node::INTEGER:
-                                args_types.emplace_back(Type::getInt32Ty(context));
-                                break;
-                            case Node::FLOATING:
-                                args_types.emplace_back(Type::getDoubleTy(context));
-                                break;
-                            case Node::STRING:
-                                args_types.emplace_back(Type::getInt8PtrTy(context));
-                                break;
-                            case Node::BOOL:
-                                args_types.emplace_back(Type::getInt1Ty(context));
-                                break;
-                            case Node::USER:
-                                args_types.emplace_back(PointerType::get(user_types.at(iterator.second->user_type_name)->llvm_type, 0));
-                                break;
-                        }
-                        args_names.emplace_back(iterator.first);
-                    }
-
-                    switch (defProperty.second.second->value_type) { // set type of the function
-                        case Node::INTEGER:
-                            type = FunctionType::get(Type::getInt32Ty(context), args_types, false);
-                            break;
-                        case Node::FLOATING:
-                            type = FunctionType::get(Type::getDoubleTy(context), args_types, false);
-                            break;
-                        case Node::STRING:
-                            type = FunctionType::get(Type::getInt8PtrTy(context), args_types, false);
-                            break;
-                        case Node::BOOL:
-                            type = FunctionType::get(Type::getInt1Ty(context), args_types, false);
-                            break;
-                        case Node::USER:
-                            type = FunctionType::get(PointerType::get(class_type, 0), args_types, false);
-                            break;
-                        default:
-                            type = FunctionType::get(Type::getVoidTy(context), args_types, false);
-                    }
-                    Function *func = Function::Create(type, Function::ExternalLinkage, defProperty.second.second->var_name, module.get());
-                    auto method = std::make_shared<Method>(func, defProperty.second.first);
-                    user_types.at(n->var_name)->methods.emplace(defProperty.second.second->var_name, method);
-
-                    BasicBlock *entry = BasicBlock::Create(context, "entry", func);
-                    builder->SetInsertPoint(entry); // set new insert block
-
-                    DISubprogram *SP;
-                    if (generateDI) {
-                        unit = dbuilder->createFile(
-                                compileUnit->getFilename(),
-                                compileUnit->getDirectory()
-                        );
-
-                        DIScope *fcontext = unit;
-                        unsigned line = n->location.line;
-                        unsigned line_scope = 0;
-                        SP = dbuilder->createMethod(
-                                fcontext,
-                                func->getName(),
-                                StringRef(),
-                                unit,
-                                line,
-                                CreateFunctionType(args_types),
-                                false,
-                                true,
-                                line_scope,
-                                DINode::FlagPrototyped,
-                                false
-                        );
-                        func->setSubprogram(SP);
-                        func_scopes[n] = SP;
-                        lexical_blocks.emplace_back(func_scopes[n]);
-                    }
-
-                    unsigned long idx = 0;
-                    for (auto &Arg : func->args()) { // create pointers to arguments of the function
-                        std::string name = args_names.at(idx++);
-                        Arg.setName(name);
-
-                        // insert argument's allocator to the table
-                        table.emplace(
-                                name,
-                                builder->CreateAlloca(
-                                        Arg.getType(),
-                                        nullptr,
-                                        name+"_ptr"
-                                )
-                        );
-                        builder->CreateStore(&Arg, table.at(name)); // store the value of argument to allocator
-                        if (generateDI) {
-                            DILocalVariable *var = dbuilder->createParameterVariable(
-                                    SP,
-                                    name,
-                                    static_cast<unsigned int>(idx),
-                                    unit,
-                                    n->location.line,
-                                    getDebugType(Arg.getType()),
-                                    true
-                            );
-                            emitLocation(n->o2);
-                        }
-                    }
-
-                    generate(defProperty.second.second->o2); // generate body of the function
-
-                    if (!func->getAttributes().hasAttribute(0, "ret")) {
-                        switch (defProperty.second.second->value_type) { // create default return value
-                            case Node::INTEGER:
-                                builder->CreateRet(ConstantInt::get(Type::getInt32Ty(context), 0));
-                                break;
-                            case Node::FLOATING:
-                                builder->CreateRet(ConstantFP::get(Type::getDoubleTy(context), 0.0));
-                                break;
-                            case Node::BOOL:
-                                builder->CreateRet(ConstantInt::get(Type::getInt1Ty(context), 0));
-                                break;
-                            default:
-                                builder->CreateRetVoid();
-                        }
-                    }
+            ClassDefinition *class_prototype = class_definition(n);
 
-                    if (optimize) {
-                        passmgr->run(*func); // run the optimizer
-                    }
-
-                    for (auto &&var : last_vars) { // erase vars declared in this function
-                        table.erase(var);
-                        last_vars.erase(std::find(std::cbegin(last_vars), std::cend(last_vars), var));
-                    }
-
-                    for (auto &Arg : func->args()) { // erase arguments' allocators from the table
-                        table.erase(Arg.getName());
-                    }
+            unsigned m = 0; // the methods are in the order of their prototypes
+            for (auto &&method : n->class_def->methods) {
+                if (method.node->kind == Node::FUNCTION_DEFINE) {
+                    define(method.node, class_prototype->methods[m++].prototype, true);
                 }
             }
 
@@ -2059,18 +1727,8 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
 
             builder->SetInsertPoint(thenBlock);
 
-            std::vector<std::string> _temp(last_vars);
-            last_vars.clear();
-
             generate(n->o2); // generate the body of 'then' branch
 
-            for (auto &&var : last_vars) {
-                table.erase(var);
-                last_vars.erase(std::find(std::cbegin(last_vars), std::cend(last_vars), var));
-            }
-
-            last_vars = _temp;
-
             builder->CreateBr(mergeBlock);
 
             parent->getBasicBlockList().push_back(elseBlock);
@@ -2100,35 +1758,15 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
 
             builder->SetInsertPoint(thenBlock);
 
-            std::vector<std::string> _temp(last_vars);
-            last_vars.clear();
-
             generate(n->o2); // generate the body of 'then' branch
 
-            for (auto &&var : last_vars) {
-                table.erase(var);
-                last_vars.erase(std::find(std::cbegin(last_vars), std::cend(last_vars), var));
-            }
-
-            last_vars = _temp;
-
             builder->CreateBr(mergeBlock);
 
             parent->getBasicBlockList().push_back(elseBlock);
             builder->SetInsertPoint(elseBlock);
 
-            std::vector<std::string> __temp(last_vars);
-            last_vars.clear();
-
             generate(n->o3); // generate the body of 'else' branch
 
-            for (auto &&var : last_vars) {
-                table.erase(var);
-                last_vars.erase(std::find(std::cbegin(last_vars), std::cend(last_vars), var));
-            }
-
-            last_vars = __temp;
-
             builder->CreateBr(mergeBlock);
 
             parent->getBasicBlockList().push_back(mergeBlock);
@@ -2148,21 +1786,11 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
 
             builder->SetInsertPoint(loopBlock);
 
-            std::vector<std::string> _temp(last_vars);
-            last_vars.clear();
-
             generate(n->o1); // generate the body
             generate(n->o2); // generate the condition
             Value *condition = stack.top(); // take it from the stack
             stack.pop(); // erase it from the stack
 
-            for (auto &&var : last_vars) {
-                table.erase(var);
-                last_vars.erase(std::find(std::cbegin(last_vars), std::cend(last_vars), var));
-            }
-
-            last_vars = _temp;
-
             BasicBlock *afterBlock = BasicBlock::Create(context, "afterloop", parent);
             builder->CreateCondBr(condition, loopBlock, afterBlock); // create conditional goto
             builder->SetInsertPoint(afterBlock); // set insert point to block after the condition
@@ -2181,18 +1809,8 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
 
             builder->SetInsertPoint(loopBlock);
 
-            std::vector<std::string> _temp(last_vars);
-            last_vars.clear();
-
             generate(n->o2); // generate the body
 
-            for (auto &&var : last_vars) {
-                table.erase(var);
-                last_vars.erase(std::find(std::cbegin(last_vars), std::cend(last_vars), var));
-            }
-
-            last_vars = _temp;
-
             generate(n->o1); // generate the condition
             Value *condition = stack.top(); // take it from the stack
             stack.pop(); // erase it from the stack
@@ -2204,10 +1822,11 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
             break;
         }
         case Node::REPEAT: { // 'repeat' cycle
-            table.try_emplace("index", builder->CreateAlloca(Type::getInt32Ty(context), nullptr, "index_ptr"));
+            Value *counter = builder->CreateAlloca(Type::getInt32Ty(context), nullptr, "index_ptr");
+            declare(n, counter);
 
             builder->CreateStore(ConstantInt::get(Type::getInt32Ty(context), APInt(32, 0)),
-                                 table.at("index")); // zeroize the counter
+                                 counter); // zeroize the counter
 
             Function *parent = builder->GetInsertBlock()->getParent();
 
@@ -2219,28 +1838,17 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
             builder->CreateBr(loopBlock); // go to begin of the loop
             builder->SetInsertPoint(loopBlock);
 
-            std::vector<std::string> _temp(last_vars);
-            last_vars.clear();
-
             generate(n->o2); // generate the body
 
-            for (auto &&var : last_vars) {
-                table.erase(var);
-                last_vars.erase(std::find(std::cbegin(last_vars), std::cend(last_vars), var));
-            }
-
-            last_vars = _temp;
-
             generate(n->o1); // generate the condition
             Value *times = stack.top(); // take it form the stack
             stack.pop(); // erase it from the stack
 
             // increment value of counter by new iteration of cycle
-            Value *counter = table.at("index");
             Value *counter_val = builder->CreateLoad(Type::getInt32Ty(context), counter, "index");
             Value *incr = builder->CreateAdd(counter_val, ConstantInt::get(Type::getInt32Ty(context),
                                                                            APInt(32, 1)), "incr");
-            builder->CreateStore(incr, table.at("index"));
+            builder->CreateStore(incr, counter);
 
             Value *condition = builder->CreateICmpSLT(incr, times, "condition"); // check condition
 
@@ -2249,164 +1857,17 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
 
             builder->SetInsertPoint(afterBlock); // set insert point to block after the condition
             builder->CreateStore(ConstantInt::get(Type::getInt32Ty(context), APInt(32, 0)),
-                                 table.at("index")); // zeroize the counter after all iterations of cycle
+                                 counter); // zeroize the counter after all iterations of cycle
 
             break;
         }
-        case Node::FUNCTION_DEFINE: { // generate function's definition
-            if (n->var_name == "main") {
-                n->value_type = Node::INTEGER;
-            }
-
-            FunctionType *type;
-
-            // generate arguments
-            std::vector<Type *> args_types;
-            std::vector<std::string> args_names;
-            for (auto &iterator : n->o1->func_def_args) {
-                switch (iterator.second->value_type) {
-                    case Node::INTEGER:
-                        args_types.emplace_back(Type::getInt32Ty(context));
-                        break;
-                    case Node::FLOATING:
-                        args_types.emplace_back(Type::getDoubleTy(context));
-                        break;
-                    case Node::STRING:
-                        args_types.emplace_back(Type::getInt8PtrTy(context));
-                        break;
-                    case Node::BOOL:
-                        args_types.emplace_back(Type::getInt1Ty(context));
-                        break;
-                    case Node::USER:
-                        args_types.emplace_back(PointerType::get(
-                                user_types.at(iterator.second->user_type_name)->llvm_type, 0)
-                        );
-                        break;
-                }
-                args_names.emplace_back(iterator.first);
-            }
-
-            switch (n->value_type) { // set type of the function
-                case Node::INTEGER:
-                    type = FunctionType::get(Type::getInt32Ty(context), args_types, false);
-                    break;
-                case Node::FLOATING:
-                    type = FunctionType::get(Type::getDoubleTy(context), args_types, false);
-                    break;
-                case Node::STRING:
-                    type = FunctionType::get(Type::getInt8PtrTy(context), args_types, false);
-                    break;
-                case Node::BOOL:
-                    type = FunctionType::get(Type::getInt1Ty(context), args_types, false);
-                    break;
-                case Node::USER:
-                    type = FunctionType::get(PointerType::get(user_types.at(n->user_type)->llvm_type, 0), args_types, false);
-                    break;
-                default:
-                    type = FunctionType::get(Type::getVoidTy(context), args_types, false);
-            }
-            Function *func = Function::Create(type, Function::ExternalLinkage, n->var_name, module.get());
-            functions.emplace(n->var_name, func);
-
-            BasicBlock *entry = BasicBlock::Create(context, "entry", func);
-            builder->SetInsertPoint(entry); // set new insert block
-
-            DISubprogram *SP;
-            if (generateDI) {
-                unit = dbuilder->createFile(
-                        compileUnit->getFilename(),
-                        compileUnit->getDirectory()
-                );
-
-                DIScope *fcontext = unit;
-                unsigned line = n->location.line;
-                unsigned line_scope = 0;
-                SP = dbuilder->createFunction(
-                        fcontext,
-                        func->getName(),
-                        StringRef(),
-                        unit,
-                        line,
-                        CreateFunctionType(args_types),
-                        false,
-                        true,
-                        line_scope,
-                        DINode::FlagPrototyped,
-                        false
-                );
-                func->setSubprogram(SP);
-                func_scopes[n] = SP;
-                lexical_blocks.emplace_back(func_scopes[n]);
-            }
-
-            unsigned idx = 0;
-            for (auto &Arg : func->args()) { // create pointers to arguments of the function
-                std::string name = args_names.at(idx++);
-                Arg.setName(name);
-
-                // insert argument's allocator to the table
-                table.emplace(
-                        name,
-                        builder->CreateAlloca(
-                                Arg.getType(),
-                                nullptr,
-                                name + "_ptr"
-                        )
-                );
-
-                builder->CreateStore(&Arg, table.at(name)); // store the value of argument to allocator
-
-                if (generateDI) {
-                    DILocalVariable *var = dbuilder->createParameterVariable(
-                            SP,
-                            name,
-                            idx,
-                            unit,
-                            n->location.line,
-                            getDebugType(Arg.getType()),
-                            true
-                    );
-                    emitLocation(n->o2);
-                }
-            }
-            generate(n->o2); // generate body of the function
-
-            lexical_blocks.pop_back();
-
-            if (!func->getAttributes().hasAttribute(0, "ret")) {
-                switch (n->value_type) { // create default return value
-                    case Node::INTEGER:
-                        builder->CreateRet(ConstantInt::get(Type::getInt32Ty(context), 0));
-                        break;
-                    case Node::FLOATING:
-                        builder->CreateRet(ConstantFP::get(Type::getDoubleTy(context), 0.0));
-                        break;
-                    case Node::BOOL:
-                        builder->CreateRet(ConstantInt::get(Type::getInt1Ty(context), 0));
-                        break;
-                    default:
-                        builder->CreateRetVoid();
-                }
-            }
-
-            if (optimize) {
-                passmgr->run(*func); // run the optimizer
-            }
-
-            for (auto &&var : last_vars) { // erase vars declared in this function
-                table.erase(var);
-                last_vars.erase(std::find(std::cbegin(last_vars), std::cend(last_vars), var));
-            }
-
-            for (auto &Arg : func->args()) { // erase arguments' allocators from the table
-                table.erase(Arg.getName());
-            }
-
+        case Node::FUNCTION_DEFINE: // generate function's definition
+            define(n, prototype(n), false);
             break;
-        }
-        case Node::SEQ:
-            generate(n->o1);
-            generate(n->o2);
+        case Node::BLOCK:
+            for (Node *statement : n->statements) { // only nested blocks recurse
+                generate(statement);
+            }
             break;
         case Node::EXPR:
             generate(n->o1);
@@ -2417,7 +1878,7 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
             stack.pop(); // erase it from the stack
 
             // set the 'ret' attribute
-            builder->GetInsertBlock()->getParent()->addAttribute(0, Attribute::get(context, "ret"));
+            builder->GetInsertBlock()->getParent()->addRetAttr(Attribute::get(context, "ret"));
 
             break;
         case Node::PRINTLN: { // print something
@@ -2430,11 +1891,11 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
 
             Value *format;
             if (stack.top()->getType()->isIntegerTy()) { // print integer
-                format = table.at("int_out_format");
+                format = int_out_format;
             } else if (stack.top()->getType()->isDoubleTy()) { // print float
-                format = table.at("float_out_format");
+                format = float_out_format;
             } else { // print string
-                format = table.at("str_out_format");
+                format = str_out_format;
             }
 
             args.emplace_back(format);
@@ -2452,11 +1913,10 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
             std::vector<Value *> args;
             Value *format;
             bool is_str_var = false;
-            if (table.at(n->var_name)->getType() == Type::getInt32PtrTy(context) ||
-                table.at(n->var_name)->getType() == Type::getDoublePtrTy(context)) {
-                format = table.at("float_in_format");
+            if (n->storage == Node::SCALAR && (n->value_type == Node::INTEGER || n->value_type == Node::FLOATING)) {
+                format = float_in_format;
             } else {
-                format = table.at("str_in_format");
+                format = str_in_format;
                 is_str_var = true;
             }
 
@@ -2465,15 +1925,16 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
             Value *var;
             if (is_str_var) {
                 var = builder->CreateGEP( // get element's pointer
-                        table.at(n->var_name),
+                        variable(n).address->getType()->getPointerElementType(),
+                        variable(n).address,
                         {
                                 ConstantInt::get(Type::getInt32Ty(context), 0),
                                 ConstantInt::get(Type::getInt32Ty(context), 0)
                         },
-                        n->var_name
+                        n->var_name.str()
                 );
             } else {
-                var = table.at(n->var_name);
+                var = variable(n).address;
             }
             args.emplace_back(var);
             builder->CreateCall(scanf, args); // call scanf
@@ -2483,18 +1944,246 @@ void Generator::generate(const std::shared_ptr<Node>& n) {
     }
 }
 
+// the type of a function or, with 'this' first, of a method
+FunctionType *Generator::function_type(const Node *n, Type *self) {
+    std::vector<Type *> args_types;
+    if (self != nullptr) {
+        args_types.emplace_back(self);
+    }
+
+    for (auto &iterator : *n->o1->func_def_args) {
+        switch (iterator.second->value_type) {
+            case Node::INTEGER:
+                args_types.emplace_back(Type::getInt32Ty(context));
+                break;
+            case Node::FLOATING:
+                args_types.emplace_back(Type::getDoubleTy(context));
+                break;
+            case Node::STRING:
+                args_types.emplace_back(Type::getInt8PtrTy(context));
+                break;
+            case Node::BOOL:
+                args_types.emplace_back(Type::getInt1Ty(context));
+                break;
+            case Node::USER:
+                args_types.emplace_back(PointerType::get(user_types.at(iterator.second->user_type_name)->llvm_type, 0));
+                break;
+        }
+    }
+
+    switch (n->value_type) { // set type of the function
+        case Node::INTEGER:
+            return FunctionType::get(Type::getInt32Ty(context), args_types, false);
+        case Node::FLOATING:
+            return FunctionType::get(Type::getDoubleTy(context), args_types, false);
+        case Node::STRING:
+            return FunctionType::get(Type::getInt8PtrTy(context), args_types, false);
+        case Node::BOOL:
+            return FunctionType::get(Type::getInt1Ty(context), args_types, false);
+        case Node::USER:
+            return FunctionType::get(PointerType::get(user_types.at(n->user_type)->llvm_type, 0), args_types, false);
+        default:
+            return FunctionType::get(Type::getVoidTy(context), args_types, false);
+    }
+}
+
+Function *Generator::prototype(const Node *n) {
+    auto found = functions.find(n->var_name);
+    if (found != std::end(functions)) {
+        return found->second;
+    }
+
+    Function *func = Function::Create(function_type(n, nullptr), Function::ExternalLinkage, n->var_name.str(), module.get());
+    functions.emplace(n->var_name, func);
+    return func;
+}
+
+Generator::ClassDefinition *Generator::class_definition(const Node *n) {
+    auto found = user_types.find(n->var_name);
+    if (found != std::end(user_types)) {
+        return found->second.get();
+    }
+
+    std::vector<Type *> properties_types;
+    for (auto &&defProperty : n->class_def->properties) { // generate properties first, in the order of the fields
+        if (defProperty.node->kind == Node::VAR_DEF) {
+            switch (defProperty.node->value_type) {
+                case Node::INTEGER:
+                    properties_types.emplace_back(Type::getInt32Ty(context));
+                    break;
+                case Node::FLOATING:
+                    properties_types.emplace_back(Type::getDoubleTy(context));
+                    break;
+                case Node::STRING:
+                    properties_types.emplace_back(Type::getInt8PtrTy(context));
+                    break;
+                case Node::BOOL:
+                    properties_types.emplace_back(Type::getInt1Ty(context));
+                    break;
+            }
+        }
+    }
+
+    StructType* class_type = StructType::create(context, n->var_name.str());
+    class_type->setName(n->var_name.str());
+    class_type->setBody(properties_types);
+
+    auto class_prototype = std::make_shared<ClassDefinition>(n->var_name, class_type);
+    user_types.emplace(n->var_name, class_prototype);
+    classes.emplace(class_type, class_prototype.get());
+
+    // a derived class has its own copy of every inherited method, and
+    // modules link by name: the symbol of a method is 'Class.method'
+    for (auto &&defProperty : n->class_def->methods) {
+        if (defProperty.node->kind == Node::FUNCTION_DEFINE) {
+            Function *func = Function::Create(
+                    function_type(defProperty.node, PointerType::get(class_type, 0)),
+                    Function::ExternalLinkage,
+                    n->var_name.str() + "." + defProperty.name.str(),
+                    module.get()
+            );
+            class_prototype->slots.emplace(defProperty.name, static_cast<unsigned>(class_prototype->methods.size()));
+            class_prototype->methods.emplace_back(func, defProperty.access_type);
+        }
+    }
+
+    return class_prototype.get();
+}
+
+void Generator::prototypes(const Node *root) {
+    if (root->kind != Node::BLOCK) {
+        return;
+    }
+
+    for (const Node *statement : root->statements) { // a class is defined above any use of it
+        if (statement->kind == Node::CLASS_DEFINE) {
+            class_definition(statement);
+        } else if (statement->kind == Node::FUNCTION_DEFINE) {
+            prototype(statement);
+        }
+    }
+}
+
+// the body of a function or method into its prototype
+void Generator::define(Node *n, Function *func, bool method) {
+    std::vector<Type *> args_types(func->getFunctionType()->param_begin(), func->getFunctionType()->param_end());
+    std::vector<Symbol> args_names;
+    if (method) {
+        args_names.emplace_back(names::self);
+    }
+    for (auto &iterator : *n->o1->func_def_args) {
+        args_names.emplace_back(iterator.first);
+    }
+
+    BasicBlock *entry = BasicBlock::Create(context, "entry", func);
+    builder->SetInsertPoint(entry); // set new insert block
+
+    DISubprogram *SP;
+    if (generateDI) {
+        unit = dbuilder->createFile(
+                compileUnit->getFilename(),
+                compileUnit->getDirectory()
+        );
+
+        DIScope *fcontext = unit;
+        unsigned line = n->location.line;
+        unsigned line_scope = 0;
+        SP = dbuilder->createFunction( // a method too: its class has no debug type to be a member of
+                fcontext,
+                func->getName(),
+                StringRef(),
+                unit,
+                line,
+                CreateFunctionType(args_types),
+                line_scope,
+                DINode::FlagPrototyped,
+                DISubprogram::SPFlagDefinition
+        );
+        func->setSubprogram(SP);
+        func_scopes[n] = SP;
+        lexical_blocks.emplace_back(func_scopes[n]);
+        emitLocation(n); // the arguments are stored in the new subprogram
+    }
+
+    frame.assign(n->frame_size, Variable()); // arguments and locals, 'this' first in a method
+    unsigned idx = 0;
+    for (auto &Arg : func->args()) { // create pointers to arguments of the function
+        Symbol name = args_names.at(idx);
+        Arg.setName(name.str());
+
+        // the slot of an argument is its place in the prototype
+        Value *address = builder->CreateAlloca(
+                Arg.getType(),
+                nullptr,
+                name.str() + "_ptr"
+        );
+        frame[idx++].address = address;
+
+        builder->CreateStore(&Arg, address); // store the value of argument to allocator
+
+        if (generateDI) {
+            DILocalVariable *var = dbuilder->createParameterVariable(
+                    SP,
+                    name.str(),
+                    idx,
+                    unit,
+                    n->location.line,
+                    getDebugType(Arg.getType()),
+                    true
+            );
+            dbuilder->insertDeclare(
+                    address,
+                    var,
+                    dbuilder->createExpression(),
+                    DILocation::get(
+                            context,
+                            n->location.line,
+                            0,
+                            SP
+                    ),
+                    builder->GetInsertBlock()
+            );
+            emitLocation(n->o2);
+        }
+    }
+    generate(n->o2); // generate body of the function
+
+    if (!func->getAttributes().hasRetAttr("ret")) {
+        switch (n->value_type) { // create default return value
+            case Node::INTEGER:
+                builder->CreateRet(ConstantInt::get(Type::getInt32Ty(context), 0));
+                break;
+            case Node::FLOATING:
+                builder->CreateRet(ConstantFP::get(Type::getDoubleTy(context), 0.0));
+                break;
+            case Node::BOOL:
+                builder->CreateRet(ConstantInt::get(Type::getInt1Ty(context), 0));
+                break;
+            default:
+                builder->CreateRetVoid();
+        }
+    }
+
+    if (generateDI) {
+        lexical_blocks.pop_back();
+        emitLocation(n);
+    }
+}
+
 DIType *Generator::getDebugType(Type *ty) {
     unsigned align = module->getDataLayout().getABITypeAlignment(ty);
     if (ty->isIntegerTy(32)) {
-        return dbuilder->createBasicType("int", 32, align, dwarf::DW_ATE_signed);
+        return dbuilder->createBasicType("int", 32, dwarf::DW_ATE_signed);
     } else if (ty->isDoubleTy()) {
-        return dbuilder->createBasicType("float", 64, align, dwarf::DW_ATE_float);
+        return dbuilder->createBasicType("float", 64, dwarf::DW_ATE_float);
     } else if (ty->isIntegerTy(8)) {
-        return dbuilder->createBasicType("char", 8, align, dwarf::DW_ATE_unsigned_char);
+        return dbuilder->createBasicType("char", 8, dwarf::DW_ATE_unsigned_char);
     } else if (ty == ArrayType::get(Type::getInt8Ty(context), 256)) {
         return dbuilder->createArrayType(256, align, getDebugType(Type::getInt8Ty(context)), nullptr);
     } else if (ty->isIntegerTy(1)) {
-        return dbuilder->createBasicType("bool", 1, align, dwarf::DW_ATE_boolean);
+        return dbuilder->createBasicType("bool", 1, dwarf::DW_ATE_boolean);
+    } else if (ty->isPointerTy()) { // a string, or an object as 'this', which has no debug type of its own
+        return dbuilder->createPointerType(getDebugType(ty->getPointerElementType()), module->getDataLayout().getPointerSizeInBits());
     } else {
         return nullptr;
     }
@@ -2509,20 +2198,73 @@ DISubroutineType *Generator::CreateFunctionType(std::vector<Type *> args) {
     return dbuilder->createSubroutineType(dbuilder->getOrCreateTypeArray(types));
 }
 
-void Generator::emitLocation(std::shared_ptr<Node> n) {
-    DIScope *scope;
-
-    if(lexical_blocks.empty()) {
-        scope = compileUnit;
-    } else {
-        scope = lexical_blocks.back();
+void Generator::emitLocation(Node *n) {
+    if (lexical_blocks.empty()) { // outside of any function, where no code is made
+        builder->SetCurrentDebugLocation(DebugLoc());
+        return;
     }
 
     builder->SetCurrentDebugLocation(
-            DebugLoc::get(
+            DILocation::get(
+                    context,
                     n->location.line,
                     n->location.column,
-                    scope
+                    lexical_blocks.back()
             )
     );
 }
+
+void ParallelGenerator::generate(Node *root) {
+    std::vector<Node *> statements;
+    if (root->kind == Node::BLOCK) {
+        statements.assign(std::begin(root->statements), std::end(root->statements));
+    } else {
+        statements.push_back(root);
+    }
+
+    auto count = static_cast<unsigned>(std::max<std::size_t>(1, std::min<std::size_t>(threads, statements.size())));
+    std::vector<std::size_t> bounds = statements.empty() ? std::vector<std::size_t>{0, 0} : split(statements, count);
+
+    units.clear();
+    for (unsigned run = 0; run != count; run++) {
+        units.push_back(std::make_unique<Generator>(generateDI, file));
+    }
+
+    auto generate_run = [&](unsigned run) {
+        Generator &unit = *units[run];
+        unit.prototypes(root);
+        for (std::size_t i = bounds[run]; i != bounds[run + 1]; i++) {
+            unit.generate(statements[i]);
+        }
+        if (generateDI) {
+            unit.dbuilder->finalize();
+        }
+    };
+
+    if (count == 1) {
+        generate_run(0);
+        return;
+    }
+
+    // the error reported is that of the first run with one, as a single module would have met it
+    std::vector<std::exception_ptr> failed(count);
+    std::vector<std::thread> workers;
+    for (unsigned run = 0; run != count; run++) {
+        workers.emplace_back([&generate_run, &failed, run] {
+            try {
+                generate_run(run);
+            } catch (...) {
+                failed[run] = std::current_exception();
+            }
+        });
+    }
+    for (auto &&worker : workers) {
+        worker.join();
+    }
+
+    for (auto &&error : failed) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
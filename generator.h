@@ -10,6 +10,7 @@
 #include <stack>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <llvm/IR/Module.h>
 #include <llvm/IR/IRBuilder.h>
@@ -18,8 +19,6 @@
 #include <llvm/IR/Function.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Value.h>
-#include <llvm/Transforms/Scalar.h>
-#include <llvm/IR/LegacyPassManager.h>
 
 using namespace llvm;
 using namespace turnip2;
@@ -37,59 +36,88 @@ class Generator {
         unsigned short access_type;
     };
 
+    // The layout of a class, fixed when it is defined: its properties are
+    // the fields of llvm_type in declaration order (the Resolver gives every
+    // access the index of its field), its methods have a slot each. A method
+    // is found by the class of the object it is called on, with one lookup.
     class ClassDefinition {
     public:
-        ClassDefinition(const std::string &n = "", StructType *ty = nullptr) : name(n), llvm_type(ty) {}
+        ClassDefinition(Symbol n = Symbol(), StructType *ty = nullptr) : name(n), llvm_type(ty) {}
 
-        std::string name;
+        Symbol name;
         StructType *llvm_type;
 
-        std::unordered_map<std::string, unsigned short> properties;
-        std::unordered_map<std::string, std::shared_ptr<Method>> methods;
+        std::vector<Method> methods; // in declaration order, the constructor last
+        std::unordered_map<Symbol, unsigned> slots; // index of every method in 'methods'
+
+        const Method &method(Symbol name) const { return methods[slots.at(name)]; }
+    };
+
+    std::unordered_map<Symbol, std::shared_ptr<ClassDefinition>> user_types;
+    std::unordered_map<StructType *, ClassDefinition *> classes; // the class of an object, by its struct type
+    ClassDefinition *class_of(Value *object); // through any number of pointers, loading none
+
+    struct Variable {
+        Value *address = nullptr;
+        Value *elements = nullptr; // of an array
     };
 
-    std::unordered_map<std::string, std::shared_ptr<ClassDefinition>> user_types;
-    std::unordered_map<std::string, Value *> table;
-    std::unordered_map<std::string, Value *> array_sizes;
-    std::unordered_map<std::string, Function *> functions;
+    // variables of the function being generated, by the slots the Resolver gave them
+    std::vector<Variable> frame;
+    Variable &variable(const Node *n) { return frame[n->resolved.slot]; }
+    void declare(const Node *n, Value *address);
+
+    std::unordered_map<Symbol, Function *> functions;
     LLVMContext context;
-    std::vector<std::string> last_vars;
 
     std::unique_ptr<IRBuilder<>> builder;
 
     std::stack<Value *> stack;
-    std::unique_ptr<legacy::FunctionPassManager> passmgr;
-    bool optimize;
 
     std::vector<Type *> printfArgs;
     FunctionType *printfType;
-    Constant *printf;
+    FunctionCallee printf;
 
     std::vector<Type *> scanfArgs;
     FunctionType *scanfType;
-    Constant *scanf;
+    FunctionCallee scanf;
 
     bool io_using = false;
 
+    // runtime format strings, made by use_io()
+    Value *int_out_format;
+    Value *float_out_format;
+    Value *str_out_format;
+    Value *float_in_format;
+    Value *str_in_format;
+
     void use_io();
 
+    Value *convert(Value *val, unsigned char type); // a number as one of 'type'
+
     bool generateDI;
     DICompileUnit *compileUnit;
 
     DIType *getDebugType(Type *ty);
 
     std::vector<DIScope *> lexical_blocks;
-    std::unordered_map<std::shared_ptr<Node>, DIScope *> func_scopes;
+    std::unordered_map<Node *, DIScope *> func_scopes;
     DIFile *unit;
 
     DISubroutineType *CreateFunctionType(std::vector<Type *> args);
 
-    void emitLocation(std::shared_ptr<Node> n);
+    void emitLocation(Node *n);
+
+    FunctionType *function_type(const Node *n, Type *self); // 'self' is the type of 'this' of a method
+    Function *prototype(const Node *n); // of a function, made once
+    ClassDefinition *class_definition(const Node *n); // the struct and the method prototypes of a class, made once
+    void define(Node *n, Function *func, bool method);
 
 public:
-    Generator(bool opt, bool genDI, const std::string &f);
+    Generator(bool genDI, const std::string &f); // the module is optimized by whoever emits it
 
-    void generate(const std::shared_ptr<Node> &n);
+    void prototypes(const Node *root); // every class and function of the program, bodies come from generate()
+    void generate(Node *n); // of a tree the Resolver has been through
 
     std::unique_ptr<Module> module;
     std::unique_ptr<DIBuilder> dbuilder;
@@ -97,4 +125,23 @@ public:
 };
 
 
+// A program generated as several modules at once. Its top-level statements
+// are split, in order, into runs of about as many lines each, one per
+// thread; a run is generated by a Generator with a context and a module of
+// its own, which declares what the other runs define. The modules are
+// linked by the names of their functions.
+class ParallelGenerator {
+    bool generateDI;
+    std::string file;
+    unsigned threads;
+
+public:
+    ParallelGenerator(bool genDI, const std::string &f, unsigned generator_threads = 1)
+            : generateDI(genDI), file(f), threads(generator_threads) {}
+
+    void generate(Node *root); // of a tree the Resolver has been through
+
+    std::vector<std::unique_ptr<Generator>> units; // in the order of the program
+};
+
 #endif //TURNIP2_GENERATOR_H
@@ -0,0 +1,349 @@
+//
+// Created by NEzyaka on 17.10.26.
+//
+
+#include "incremental.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+    constexpr std::size_t SLACK = 1 << 20; // arena bytes an edit may leave behind on top of the tree's size
+
+    bool same_type(const std::shared_ptr<types::Type> &x, const std::shared_ptr<types::Type> &y) {
+        return x == y || (x && y && x->value_type == y->value_type && x->user_type_name == y->user_type_name);
+    }
+
+    // a later statement resolves the name the same way under both
+    bool same_binding(const Lexer::Binding &x, const Lexer::Binding &y) {
+        return same_type(x.var, y.var) && same_type(x.array, y.array) && same_type(x.function, y.function) && x.type == y.type;
+    }
+
+    bool unchanged(const Lexer::Binding &x, const Lexer::Binding &y) {
+        return x.var == y.var && x.array == y.array && x.function == y.function && x.type == y.type;
+    }
+
+    void bind(Lexer &lexer, Symbol name, const Lexer::Binding &binding) {
+        if (binding.empty()) {
+            lexer.symbols.erase(name);
+        } else {
+            lexer.symbols[name] = binding;
+        }
+    }
+
+    template <typename It>
+    std::unordered_map<Symbol, const Lexer::Binding *> net_effect(It first, It last) {
+        std::unordered_map<Symbol, const Lexer::Binding *> bound;
+        for (; first != last; ++first) {
+            for (auto &&declaration : first->declared) {
+                bound[declaration.name] = &declaration.after;
+            }
+        }
+        return bound;
+    }
+
+    bool is_comparison(const Node *n) {
+        return n != nullptr && n->kind >= Node::LESS && n->kind <= Node::NOT_EQUAL;
+    }
+
+    // the comparison 'b <= c' when 'x' is 'a < b and b <= c', built from the
+    // chain 'a < b <= c' with 'b' shared, nullptr for any other AND
+    Node *chained(const Node *x) {
+        const Node *before = x->o1 != nullptr && x->o1->kind == Node::AND ? x->o1->o2 : x->o1;
+        if (is_comparison(before) && is_comparison(x->o2) && x->o2->o1 == before->o2) {
+            return x->o2;
+        }
+        return nullptr;
+    }
+
+    // where the line holding text[at] begins, npos unless only blanks precede 'at' on it
+    std::size_t line_start(const std::string &text, std::size_t at) {
+        while (at != 0 && (text[at - 1] == ' ' || text[at - 1] == '\t')) {
+            at--;
+        }
+        return at == 0 || text[at - 1] == '\n' || text[at - 1] == '\r' ? at : std::string::npos;
+    }
+}
+
+IncrementalParser::Unit IncrementalParser::parse_unit() {
+    Unit unit{lexer->position(), nullptr, {}};
+
+    lexer->declarations.clear();
+    unit.node = parser->top_level();
+
+    // one entry per name: the binding before the statement and the one now,
+    // names it bound only for a while (locals, arguments) are left out
+    for (auto &&declaration : lexer->declarations) {
+        auto seen = std::find_if(std::begin(unit.declared), std::end(unit.declared),
+                                 [&](const Lexer::Declaration &d) { return d.name == declaration.name; });
+        if (seen == std::end(unit.declared)) {
+            unit.declared.push_back(std::move(declaration));
+        }
+    }
+    for (auto &&declaration : unit.declared) {
+        auto binding = lexer->symbols.find(declaration.name);
+        if (binding != std::end(lexer->symbols)) {
+            declaration.after = binding->second;
+        }
+    }
+    unit.declared.erase(std::remove_if(std::begin(unit.declared), std::end(unit.declared),
+                                       [](const Lexer::Declaration &d) { return unchanged(d.before, d.after); }),
+                        std::end(unit.declared));
+
+    // A class or function was declared ahead, for the whole file: hiding it
+    // leaves it bound, and a statement parsed in its place has to bind it
+    // the same way.
+    if (unit.node->kind == Node::FUNCTION_DEFINE || unit.node->kind == Node::CLASS_DEFINE) {
+        Symbol name = unit.node->var_name;
+        auto binding = lexer->symbols.find(name);
+        bool logged = std::any_of(std::begin(unit.declared), std::end(unit.declared),
+                                  [&](const Lexer::Declaration &d) { return d.name == name; });
+        if (!logged && binding != std::end(lexer->symbols)) {
+            unit.declared.push_back({name, binding->second, binding->second});
+        }
+    }
+
+    return unit;
+}
+
+Node *IncrementalParser::root() {
+    std::vector<Node *> statements;
+    statements.reserve(units.size());
+    for (auto &&unit : units) {
+        statements.push_back(unit.node);
+    }
+
+    Node *x = arena->make<Node>(Node::BLOCK);
+    x->statements = {arena->copy(statements.data(), statements.size()), static_cast<std::uint32_t>(statements.size())};
+    return x;
+}
+
+std::size_t IncrementalParser::unit_start(std::size_t i) const {
+    return i == 0 ? 0 : lexer->token_offset(units[i].first);
+}
+
+void IncrementalParser::hide(std::size_t from) {
+    for (std::size_t i = units.size(); i-- > from;) {
+        for (auto &&declaration : units[i].declared) {
+            bind(*lexer, declaration.name, declaration.before);
+        }
+    }
+}
+
+void IncrementalParser::show(std::size_t from) {
+    for (std::size_t i = from; i != units.size(); i++) {
+        for (auto &&declaration : units[i].declared) {
+            bind(*lexer, declaration.name, declaration.after);
+        }
+    }
+}
+
+// Moves the nodes of units 'from' and later by 'delta' lines. The tree is a
+// DAG in two places: a comparison chain shares its middle operands, and a
+// derived class lists the members of its base; those are moved once, and
+// members of a base above the edit (on lines before 'below') not at all.
+void IncrementalParser::shift_lines(std::size_t from, unsigned below, int delta) {
+    std::unordered_set<Node *> members;
+    std::vector<Node *> pending;
+
+    auto shift = [delta](Node *n) {
+        if (n->location.line != 0) { // some nodes, argument lists for one, have no place in the text
+            n->location.line = static_cast<unsigned>(static_cast<int>(n->location.line) + delta);
+        }
+    };
+    auto member = [&](Node *n) {
+        if (n->location.line >= below && members.insert(n).second) {
+            pending.push_back(n);
+        }
+    };
+
+    for (std::size_t i = from; i != units.size(); i++) {
+        pending.push_back(units[i].node);
+    }
+
+    while (!pending.empty()) {
+        Node *n = pending.back();
+        pending.pop_back();
+
+        for (; n != nullptr; n = n->o1) { // down the left operands, the others wait
+            shift(n);
+
+            Node *right = n->o2;
+            if (Node *compared = n->kind == Node::AND ? chained(n) : nullptr) {
+                shift(compared); // its left operand is also the right one of the comparison before
+                right = compared->o2;
+            }
+            for (Node *operand : {right, n->o3}) {
+                if (operand != nullptr) {
+                    pending.push_back(operand);
+                }
+            }
+
+            if (n->has_call_args()) {
+                pending.insert(std::end(pending), std::begin(n->func_call_args), std::end(n->func_call_args));
+            } else if (n->kind == Node::BLOCK) {
+                pending.insert(std::end(pending), std::begin(n->statements), std::end(n->statements));
+            } else if (n->kind == Node::CLASS_DEFINE) {
+                for (auto &&method : n->class_def->methods) {
+                    member(method.node);
+                }
+                for (auto &&property : n->class_def->properties) {
+                    member(property.node);
+                }
+            }
+        }
+    }
+}
+
+Node *IncrementalParser::parse() {
+    stale = true;
+    units.clear();
+
+    arena = std::make_unique<Arena>();
+    lexer = std::make_unique<Lexer>();
+    parser = std::make_unique<Parser>(lexer.get(), arena.get());
+
+    lexer->log_declarations = true;
+    lexer->load(text);
+    lexer->tokenize(threads);
+    parser->declare_all();
+    lexer->seek(0);
+    lexer->next_token();
+
+    while (lexer->sym != Lexer::EOI) {
+        units.push_back(parse_unit());
+    }
+    parser->finish();
+
+    full_bytes = arena->bytes();
+    last_reparsed = units.size();
+    stale = false;
+    return root();
+}
+
+Node *IncrementalParser::edit(std::size_t offset, std::size_t removed, std::string_view inserted) {
+    if (offset > text.size() || removed > text.size() - offset) {
+        throw std::out_of_range("edit outside of the source");
+    }
+
+    text.replace(offset, removed, inserted);
+    if (stale || units.empty() || arena->bytes() > 2 * full_bytes + SLACK) {
+        return parse();
+    }
+    stale = true;
+
+    auto moved = static_cast<std::int64_t>(inserted.size()) - static_cast<std::int64_t>(removed);
+    std::size_t edited = offset + inserted.size(); // end of the edit in the new text
+
+    // Units [a, next) are parsed again: 'a' holds the start of the edit and
+    // begins a line, 'next' begins after the end of the edit on a line of
+    // its own that the edit left alone.
+    auto a = static_cast<std::size_t>(std::partition_point(std::begin(units), std::end(units), [&](const Unit &u) {
+        return lexer->token_offset(u.first) < offset;
+    }) - std::begin(units));
+    a = a != 0 ? a - 1 : 0;
+    while (a != 0 && line_start(text, unit_start(a)) == std::string::npos) {
+        a--;
+    }
+    std::size_t from = line_start(text, unit_start(a));
+
+    auto next = static_cast<std::size_t>(std::partition_point(std::begin(units), std::end(units), [&](const Unit &u) {
+        return lexer->token_offset(u.first) <= offset + removed;
+    }) - std::begin(units));
+    next = std::max(next, a + 1);
+
+    std::size_t count = lexer->token_count();
+    unsigned below = 0;
+    for (;; next++) {
+        while (next != units.size()) {
+            std::size_t start = line_start(text, static_cast<std::size_t>(unit_start(next) + moved));
+            if (start != std::string::npos && start > edited) {
+                break;
+            }
+            next++;
+        }
+
+        bool tail = next != units.size();
+        std::size_t last = tail ? units[next].first : count;
+        std::size_t to = tail ? static_cast<std::size_t>(unit_start(next) + moved) : text.size();
+
+        below = tail ? lexer->token_line(last) : 0;
+        if (lexer->relex(text, units[a].first, last, from, to)) {
+            break;
+        }
+    }
+
+    auto dt = static_cast<std::int64_t>(lexer->token_count()) - static_cast<std::int64_t>(count);
+    for (std::size_t i = next; i != units.size(); i++) {
+        units[i].first = static_cast<std::size_t>(units[i].first + dt);
+    }
+    int lines = next != units.size() ? static_cast<int>(lexer->token_line(units[next].first)) - static_cast<int>(below) : 0;
+
+    // parse from 'a' with the symbol table as it was there, on until the
+    // parser is back in step with a unit that is kept
+    hide(a);
+    lexer->seek(units[a].first);
+    lexer->next_token();
+
+    std::vector<Unit> fresh;
+    try {
+        for (;;) {
+            while (next != units.size() && units[next].first < lexer->position()) {
+                next++;
+            }
+            if (lexer->sym == Lexer::EOI || (next != units.size() && units[next].first == lexer->position())) {
+                break;
+            }
+            fresh.push_back(parse_unit());
+        }
+    } catch (...) {
+        return parse(); // errors are reported by a full parse, a class parsed twice may report false ones
+    }
+
+    // Later statements were resolved against the old declarations. Classes
+    // are never reused: a derived class writes into its base's members.
+    auto is_class = [](const Unit &u) { return u.node->kind == Node::CLASS_DEFINE; };
+    if (std::any_of(std::begin(units) + a, std::begin(units) + next, is_class) ||
+        std::any_of(std::begin(fresh), std::end(fresh), is_class)) {
+        return parse();
+    }
+
+    // a function added, removed or renamed is checked against the whole file
+    auto functions = [](auto first, auto last) {
+        std::vector<std::uint32_t> names;
+        for (; first != last; ++first) {
+            if (first->node->kind == Node::FUNCTION_DEFINE) {
+                names.push_back(first->node->var_name.index());
+            }
+        }
+        std::sort(std::begin(names), std::end(names));
+        return names;
+    };
+    if (functions(std::begin(units) + a, std::begin(units) + next) != functions(std::begin(fresh), std::end(fresh))) {
+        return parse();
+    }
+
+    auto before = net_effect(std::begin(units) + a, std::begin(units) + next);
+    auto after = net_effect(std::begin(fresh), std::end(fresh));
+    bool same = before.size() == after.size() && std::all_of(std::begin(after), std::end(after), [&](const auto &bound) {
+        auto old = before.find(bound.first);
+        return old != std::end(before) && same_binding(*old->second, *bound.second);
+    });
+    if (!same) {
+        return parse();
+    }
+
+    show(next);
+    if (lines != 0) {
+        shift_lines(next, below, lines);
+    }
+
+    units.erase(std::begin(units) + a, std::begin(units) + next);
+    units.insert(std::begin(units) + a, std::make_move_iterator(std::begin(fresh)), std::make_move_iterator(std::end(fresh)));
+
+    last_reparsed = fresh.size();
+    stale = false;
+    return root();
+}
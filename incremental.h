@@ -0,0 +1,69 @@
+//
+// Created by NEzyaka on 17.10.26.
+//
+
+#ifndef TURNIP2_INCREMENTAL_H
+#define TURNIP2_INCREMENTAL_H
+
+#include "arena.h"
+#include "lexer.h"
+#include "parser.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace turnip2;
+
+// Keeps the tokens and the tree of one file between edits. An edit is lexed
+// again around the change, and only the top-level statements it touches
+// (functions, classes, global code) are parsed again; the others are reused
+// and moved to their new lines. A full parse is made instead when the new
+// statements declare something else than the old ones did (a function's
+// return type, a new global), when a class is among them, or when the
+// garbage left in the arena outgrows the tree. Every class and function is
+// declared ahead as Parser::parse() does, so either may be used above its
+// definition; the statements are then parsed one after the other, and a
+// statement parsed again sees the classes and functions of the whole file.
+class IncrementalParser {
+    struct Unit {
+        std::size_t first; // buffer index of its first token
+        Node *node;
+        std::vector<Lexer::Declaration> declared; // what it changed in the symbol table, one entry per name
+    };
+
+    std::string text;
+    unsigned threads;
+
+    std::unique_ptr<Arena> arena;
+    std::unique_ptr<Lexer> lexer;
+    std::unique_ptr<Parser> parser;
+
+    std::vector<Unit> units;
+    bool stale = true; // the last call failed, the state is no good for an edit
+    std::size_t full_bytes = 0; // arena used by the last full parse
+    std::size_t last_reparsed = 0;
+
+    Unit parse_unit();
+    Node *root();
+    std::size_t unit_start(std::size_t i) const; // offset of the text unit 'i' owns, in the buffer's coordinates
+    void hide(std::size_t from); // take back what units 'from' and later declared
+    void show(std::size_t from);
+    void shift_lines(std::size_t from, unsigned below, int delta);
+
+public:
+    explicit IncrementalParser(std::string source, unsigned lexer_threads = 1)
+        : text(std::move(source)), threads(lexer_threads) {}
+
+    // Trees share nodes with the ones before them, each stays valid until
+    // the next call. Parse errors are thrown like Parser::parse() does.
+    Node *parse();
+    Node *edit(std::size_t offset, std::size_t removed, std::string_view inserted);
+
+    const std::string &source() const { return text; }
+    std::size_t reparsed() const { return last_reparsed; } // top-level statements the last call parsed
+};
+
+
+#endif //TURNIP2_INCREMENTAL_H
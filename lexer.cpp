@@ -3,13 +3,407 @@
 //
 
 #include "lexer.h"
+#include <algorithm>
+#include <charconv>
 #include <iostream>
+#include <cstdio>
 #include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+    constexpr std::size_t MIN_CHUNK = 1 << 20; // smaller inputs are not worth a thread
+    constexpr std::size_t WINDOW_SIZE = 1 << 20; // memory for a streamed input, also its longest token
+
+    struct Keyword {
+        std::string_view word;
+        int token;
+    };
+
+    constexpr Keyword KEYWORDS[] = {
+        {"array",     Lexer::ARRAY},
+        {"of",        Lexer::OF},
+        {"int",       Lexer::INT},
+        {"float",     Lexer::FLOAT},
+        {"string",    Lexer::STRING},
+        {"bool",      Lexer::BOOL},
+        {"class",     Lexer::CLASS},
+        {"private",   Lexer::PRIVATE},
+        {"public",    Lexer::PUBLIC},
+        {"protected", Lexer::PROTECTED},
+        {"override",  Lexer::OVERRIDE},
+        {"if",        Lexer::IF},
+        {"else",      Lexer::ELSE},
+        {"while",     Lexer::WHILE},
+        {"do",        Lexer::DO},
+        {"repeat",    Lexer::REPEAT},
+        {"var",       Lexer::VAR},
+        {"del",       Lexer::DELETE},
+        {"is",        Lexer::IS},
+        {"and",       Lexer::AND},
+        {"or",        Lexer::OR},
+        {"not",       Lexer::NOT},
+        {"true",      Lexer::TRUE},
+        {"false",     Lexer::FALSE},
+        {"println",   Lexer::PRINTLN},
+        {"input",     Lexer::INPUT},
+        {"function",  Lexer::FUNCTION},
+        {"return",    Lexer::RETURN}
+    };
+
+    // Perfect hash over the keywords above: first char, last char and length
+    // pick a distinct slot for every keyword, so a lookup is one string compare.
+    constexpr unsigned KEYWORD_SLOTS = 64;
+
+    constexpr unsigned keyword_slot(std::string_view word) {
+        return (static_cast<unsigned char>(word.front()) * 27u
+                + static_cast<unsigned char>(word.back()) * 3u
+                + static_cast<unsigned>(word.size())) % KEYWORD_SLOTS;
+    }
+
+    struct KeywordTable {
+        Keyword slots[KEYWORD_SLOTS] = {};
+        bool perfect = true;
+    };
+
+    constexpr KeywordTable make_keyword_table() {
+        KeywordTable table{};
+
+        for (auto &&keyword : KEYWORDS) {
+            Keyword &slot = table.slots[keyword_slot(keyword.word)];
+            if (!slot.word.empty()) {
+                table.perfect = false;
+            }
+
+            slot = keyword;
+        }
+
+        return table;
+    }
+
+    constexpr KeywordTable KEYWORD_TABLE = make_keyword_table();
+    static_assert(KEYWORD_TABLE.perfect, "keyword hash has collisions, change its multipliers");
+
+    int keyword(std::string_view word) {
+        const Keyword &slot = KEYWORD_TABLE.slots[keyword_slot(word)];
+        return slot.word == word ? slot.token : -1;
+    }
 
-void Lexer::load(std::vector<char> c) {
+    // Comments and string literals are skipped in bulk: these kernels look at
+    // 32 (AVX2) or 16 (SSE2) bytes per step and finish the tail byte by byte.
+
+    // first byte in [p, end) equal to a or b, end when there is none
+    const char *find_either(const char *p, const char *end, char a, char b) {
+#if defined(__AVX2__)
+        const __m256i va = _mm256_set1_epi8(a);
+        const __m256i vb = _mm256_set1_epi8(b);
+        for (; end - p >= 32; p += 32) {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+            auto mask = static_cast<unsigned>(_mm256_movemask_epi8(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(chunk, va), _mm256_cmpeq_epi8(chunk, vb))));
+            if (mask != 0) {
+                return p + __builtin_ctz(mask);
+            }
+        }
+#elif defined(__SSE2__)
+        const __m128i va = _mm_set1_epi8(a);
+        const __m128i vb = _mm_set1_epi8(b);
+        for (; end - p >= 16; p += 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            auto mask = static_cast<unsigned>(_mm_movemask_epi8(
+                    _mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb))));
+            if (mask != 0) {
+                return p + __builtin_ctz(mask);
+            }
+        }
+#endif
+        for (; p != end; ++p) {
+            if (*p == a || *p == b) {
+                return p;
+            }
+        }
+
+        return end;
+    }
+
+    // number of line breaks in [p, end), '\r' and '\n' each count like in Lexer::scan
+    unsigned count_breaks(const char *p, const char *end) {
+        unsigned n = 0;
+#if defined(__AVX2__)
+        const __m256i cr = _mm256_set1_epi8('\r');
+        const __m256i lf = _mm256_set1_epi8('\n');
+        for (; end - p >= 32; p += 32) {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+            n += __builtin_popcount(static_cast<unsigned>(_mm256_movemask_epi8(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(chunk, cr), _mm256_cmpeq_epi8(chunk, lf)))));
+        }
+#elif defined(__SSE2__)
+        const __m128i cr = _mm_set1_epi8('\r');
+        const __m128i lf = _mm_set1_epi8('\n');
+        for (; end - p >= 16; p += 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            n += __builtin_popcount(static_cast<unsigned>(_mm_movemask_epi8(
+                    _mm_or_si128(_mm_cmpeq_epi8(chunk, cr), _mm_cmpeq_epi8(chunk, lf)))));
+        }
+#endif
+        for (; p != end; ++p) {
+            n += *p == '\r' || *p == '\n';
+        }
+
+        return n;
+    }
+}
+
+void Lexer::load(std::string_view c) {
     ch = ' ';
-    code = c;
-    iter = code.begin();
+    begin = c.data();
+    iter = c.data();
+    end = c.data() + c.size();
+    input = nullptr;
+
+    buffered = false;
+    cursor = 0;
+    stop = SIZE_MAX;
+    tokens = TokenBuffer{};
+}
+
+void Lexer::stream(Stream &in) {
+    window.resize(WINDOW_SIZE);
+
+    input = &in;
+    exhausted = false;
+    begin = window.data();
+    iter = begin;
+    end = begin;
+    start = begin;
+    fill(); // before the first getc(), whose ' ' sentinel is not in the window
+
+    ch = ' ';
+    buffered = false;
+    cursor = 0;
+    stop = SIZE_MAX;
+    tokens = TokenBuffer{};
+}
+
+void Lexer::tokenize(unsigned threads) {
+    if (input != nullptr) {
+        return; // a stream is never whole in memory, next_token scans it as it goes
+    }
+
+    Location first = location;
+
+    // Speculative split: every chunk after the first starts right after a
+    // line break and assumes it is not inside a comment or a string there.
+    // A chunk that ends inside a block comment, or fails, was wrong about
+    // that; it is lexed again together with the next chunk.
+    auto size = static_cast<std::size_t>(end - begin);
+    std::size_t count = std::max<std::size_t>(1, std::min<std::size_t>(threads, size / MIN_CHUNK));
+
+    std::vector<Chunk> chunks;
+    const char *from = begin;
+    for (std::size_t k = 1; k <= count && from != end; k++) {
+        const char *to = end;
+        if (k != count) {
+            to = find_either(begin + size / count * k, end, '\n', '\n');
+            to = to != end ? to + 1 : end;
+        }
+
+        if (to > from) {
+            chunks.push_back({from, to});
+            from = to;
+        }
+    }
+
+    if (chunks.empty()) {
+        chunks.push_back({begin, end}); // empty input still yields EOI
+    }
+
+    if (chunks.size() == 1) {
+        lex_chunk(chunks.front(), true);
+    } else {
+        std::vector<std::thread> workers;
+        for (auto &&chunk : chunks) {
+            workers.emplace_back([this, &chunk] { lex_chunk(chunk, false); });
+        }
+        for (auto &&worker : workers) {
+            worker.join();
+        }
+    }
+
+    unsigned first_line = 1;
+    for (std::size_t i = 0; i != chunks.size();) {
+        Chunk &chunk = chunks[i++];
+
+        while (!chunk.clean) {
+            if (chunk.to != end) {
+                chunk.to = chunks[i++].to;
+            }
+            lex_chunk(chunk, chunk.to == end, first_line); // only the last chunk's errors are real
+        }
+
+        const TokenBuffer &part = chunk.tokens;
+        std::size_t n = chunk.to != end ? part.size() - 1 : part.size(); // only the last EOI stays
+
+        tokens.kind.insert(std::end(tokens.kind), std::begin(part.kind), std::begin(part.kind) + n);
+        tokens.offset.insert(std::end(tokens.offset), std::begin(part.offset), std::begin(part.offset) + n);
+        tokens.length.insert(std::end(tokens.length), std::begin(part.length), std::begin(part.length) + n);
+        for (std::size_t t = 0; t != n; t++) {
+            tokens.line.push_back(part.line[t] + first_line - chunk.first_line);
+        }
+        tokens.column.insert(std::end(tokens.column), std::begin(part.column), std::begin(part.column) + n);
+
+        first_line += count_breaks(chunk.from, chunk.to);
+    }
+
+    buffered = true;
+    cursor = 0;
+    stop = SIZE_MAX;
+    line = 1;
+    column = 1;
+    location = first;
+}
+
+void Lexer::lex_chunk(Chunk &chunk, bool report, unsigned first_line) {
+    Lexer l;
+    l.line = first_line;
+    l.ch = ' ';
+    l.begin = begin;
+    l.iter = chunk.from;
+    l.end = chunk.to;
+
+    chunk.tokens = TokenBuffer{};
+    chunk.first_line = first_line;
+    chunk.clean = false;
+
+    try {
+        do {
+            l.scan();
+
+            chunk.tokens.kind.push_back(static_cast<unsigned char>(l.sym));
+            chunk.tokens.offset.push_back(static_cast<std::uint32_t>(l.text.data() - begin));
+            chunk.tokens.length.push_back(static_cast<std::uint32_t>(l.text.size()));
+            chunk.tokens.line.push_back(l.location.line);
+            chunk.tokens.column.push_back(l.location.column);
+        } while (l.sym != EOI);
+    } catch (const std::string &) {
+        if (report) {
+            throw;
+        }
+        return;
+    }
+
+    chunk.clean = !l.open || chunk.to == end;
+}
+
+bool Lexer::relex(std::string_view c, std::size_t first, std::size_t last, std::size_t from, std::size_t to) {
+    std::int64_t shift = static_cast<std::int64_t>(c.size()) - (end - begin); // the tail moves with the text
+    begin = c.data();
+    end = c.data() + c.size();
+
+    // the text before 'from' is unchanged, so is the line it starts on
+    unsigned first_line = first == 0
+            ? 1 + count_breaks(begin, begin + from)
+            : tokens.line[first - 1] + count_breaks(begin + tokens.offset[first - 1], begin + from);
+
+    Chunk chunk{begin + from, begin + to};
+    lex_chunk(chunk, chunk.to == end, first_line); // only errors at the very end are real
+    if (!chunk.clean) {
+        return false;
+    }
+
+    const TokenBuffer &part = chunk.tokens;
+    bool tail = last < tokens.size(); // tokens behind the edit, their EOI is kept
+    std::size_t n = tail ? part.size() - 1 : part.size();
+    std::int64_t lines = 0;
+    if (tail) {
+        lines = static_cast<std::int64_t>(first_line + count_breaks(chunk.from, begin + tokens.offset[last] + shift)) - tokens.line[last];
+    }
+
+    auto splice = [&](auto &column, const auto &with) { // moves the tail once, if at all
+        if (n > last - first) {
+            column.insert(std::begin(column) + last, n - (last - first), {});
+        } else {
+            column.erase(std::begin(column) + first + n, std::begin(column) + last);
+        }
+        std::copy(std::begin(with), std::begin(with) + n, std::begin(column) + first);
+    };
+    splice(tokens.kind, part.kind);
+    splice(tokens.offset, part.offset);
+    splice(tokens.length, part.length);
+    splice(tokens.line, part.line);
+    splice(tokens.column, part.column);
+
+    for (std::size_t t = first + n; (shift != 0 || lines != 0) && t != tokens.size(); t++) {
+        tokens.offset[t] = static_cast<std::uint32_t>(tokens.offset[t] + shift);
+        tokens.line[t] = static_cast<unsigned>(tokens.line[t] + lines);
+    }
+
+    return true;
+}
+
+int Lexer::peek(std::size_t n) const {
+    if (!buffered) {
+        return -1;
+    }
+
+    const TokenBuffer &t = buffer();
+    std::size_t i = cursor + n - 1;
+    return t.kind[i < std::min(stop, t.size()) ? i : t.size() - 1];
+}
+
+std::size_t Lexer::skip_braces() {
+    const TokenBuffer &t = buffer();
+    std::size_t last = std::min(stop, t.size() - 1); // EOI closes whatever is open
+
+    unsigned depth = 1;
+    while (cursor < last) {
+        int kind = t.kind[cursor++];
+        if (kind == L_BRACKET) {
+            depth++;
+        } else if (kind == R_BRACKET && --depth == 0) {
+            break;
+        }
+    }
+    return cursor;
+}
+
+// A method body of a single statement ends where a member can start: at a
+// 'function', an access or 'override' keyword or a 'name:' outside of any
+// bracket ('var name:' being a statement), or at the '}' of the class.
+std::size_t Lexer::skip_member() {
+    const TokenBuffer &t = buffer();
+    std::size_t last = std::min(stop, t.size() - 1);
+
+    unsigned depth = 0;
+    for (cursor--; cursor < last; cursor++) {
+        int kind = t.kind[cursor];
+        if (kind == L_BRACKET || kind == L_PARENT || kind == L_ACCESS) {
+            depth++;
+        } else if (kind == R_BRACKET || kind == R_PARENT || kind == R_ACCESS) {
+            if (depth == 0) {
+                break;
+            }
+            depth--;
+        } else if (depth == 0 && (kind == FUNCTION || kind == OVERRIDE || kind == PRIVATE || kind == PUBLIC || kind == PROTECTED
+                                  || (kind == NAME && t.kind[cursor + 1] == TYPE && t.kind[cursor - 1] != VAR))) {
+            break;
+        }
+    }
+    return cursor;
+}
+
+void Lexer::attach(const Lexer &other) {
+    begin = other.begin;
+    end = other.end;
+    origin = &other;
+    buffered = true;
+    cursor = 0;
+    stop = SIZE_MAX;
+    symbols = other.symbols;
 }
 
 void Lexer::error(const std::string &e) {
@@ -17,14 +411,190 @@ void Lexer::error(const std::string &e) {
 }
 
 void Lexer::getc() {
-    ch = *iter;
-    iter++;
+    if (iter == end) {
+        fill();
+    }
+
+    ch = iter != end ? static_cast<unsigned char>(*iter++) : EOF;
     column++;
     location = {line, column};
 }
 
+int Lexer::lookahead() {
+    if (iter == end) {
+        fill();
+    }
+
+    return iter != end ? static_cast<unsigned char>(*iter) : EOF;
+}
+
+const char *Lexer::mark() const {
+    return ch != EOF ? iter - 1 : end;
+}
+
+bool Lexer::fill() {
+    if (input == nullptr || exhausted) {
+        return false;
+    }
+
+    auto keep = static_cast<std::size_t>(end - start);
+    if (keep == window.size()) {
+        error("token does not fit in the " + std::to_string(window.size()) + "-byte input buffer");
+    }
+
+    char *front = window.data();
+    std::memmove(front, start, keep);
+    iter -= start - front;
+    start = front;
+
+    std::size_t n = input->read(front + keep, window.size() - keep);
+    exhausted = n == 0;
+    end = front + keep + n;
+
+    return n != 0;
+}
+
+void Lexer::advance(const char *to) {
+    const char *from = mark();
+
+    unsigned breaks = count_breaks(from, to);
+    if (breaks != 0) {
+        const char *last = to - 1;
+        while (*last != '\n' && *last != '\r') {
+            --last;
+        }
+
+        line += breaks;
+        column = 1 + static_cast<unsigned>(to - last); // as if scan() had reset it on the last break
+    } else {
+        column += static_cast<unsigned>(to - from);
+    }
+
+    ch = to != end ? static_cast<unsigned char>(*to) : EOF;
+    iter = to != end ? to + 1 : end;
+    location = {line, column};
+}
+
+void Lexer::skip_to(char a, char b, bool keep) {
+    for (;;) {
+        const char *to = find_either(mark() + 1, end, a, b);
+        if (to != end || input == nullptr) {
+            advance(to);
+            break;
+        }
+
+        advance(end - 1); // park on the last byte, the window is refilled behind it
+        if (!keep) {
+            start = mark();
+        }
+
+        if (!fill()) {
+            advance(end);
+            break;
+        }
+    }
+
+    if (!keep) {
+        start = mark(); // skipped text is not part of any token
+    }
+}
+
 void Lexer::next_token(bool ignore) {
+    if (buffered) {
+        const TokenBuffer &t = buffer();
+        std::size_t i = cursor < std::min(stop, t.size()) ? cursor++ : t.size() - 1; // stay on EOI once reached
+
+        sym = t.kind[i];
+        text = {begin + t.offset[i], t.length[i]};
+        line = t.line[i];
+        column = t.column[i];
+        location = {line, column};
+    } else {
+        scan();
+    }
+
+    decode(ignore);
+}
+
+void Lexer::decode(bool ignore) {
+    switch (sym) {
+        case NUM_I: {
+            const char *first = text.data();
+            const char *last = text.data() + text.size();
+
+            int base = 10;
+            if (text.size() > 1 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+                base = 16;
+                first += 2;
+            } else if (text.size() > 1 && text[0] == '0' && (text[1] == 'b' || text[1] == 'B')) {
+                base = 2;
+                first += 2;
+            }
+
+            auto result = std::from_chars(first, last, int_val, base);
+            if (result.ec == std::errc::result_out_of_range) {
+                error("integer literal '" + std::string(text) + "' is too large");
+            }
+            if (result.ec != std::errc() || result.ptr != last) {
+                error("invalid integer literal '" + std::string(text) + "'");
+            }
+            break;
+        }
+        case NUM_F: {
+            const char *last = text.data() + text.size();
+
+            auto result = std::from_chars(text.data(), last, float_val, std::chars_format::fixed);
+            if (result.ec == std::errc::result_out_of_range) {
+                error("floating literal '" + std::string(text) + "' is out of range");
+            }
+            if (result.ec != std::errc() || result.ptr != last) {
+                error("invalid floating literal '" + std::string(text) + "'");
+            }
+            break;
+        }
+        case STR:
+            str_val.assign(std::cbegin(text), std::cend(text));
+            break;
+        case NAME:
+            resolve(ignore);
+            break;
+        default:
+            break;
+    }
+}
+
+void Lexer::resolve(bool ignore) {
+    name = intern(text);
+    sym = -1;
+
+    if (name == names::index) {
+        sym = ID;
+    }
+
+    auto binding = symbols.find(name);
+    if (binding != std::cend(symbols)) {
+        if (binding->second.type) {
+            sym = USER_TYPE;
+        } else if (binding->second.function) {
+            sym = FUNCTION_ID;
+        } else if (binding->second.var) {
+            sym = ID;
+        }
+    }
+
+    if (sym == -1) {
+        if (ignore) {
+            sym = ID;
+        } else {
+            error("'" + name.str() + "' was not declared in this scope");
+        }
+    }
+}
+
+void Lexer::scan() {
     again:
+    start = mark();
+
     switch (ch) {
         case '\n':
         case '\r':
@@ -72,39 +642,23 @@ void Lexer::next_token(bool ignore) {
             getc();
 
             if (ch == '/') {
-                do {
-                    getc();
-                } while (ch != EOF && ch != '\n' && ch != '\r');
-
-                if (ch != EOF) {
-                    next_token();
-                }
-
-                break;
+                skip_to('\n', '\r', false);
+                goto again;
             }
 
             if (ch == '*') {
-                while (true) {
-                    getc();
-
-                    if (ch == EOF) {
-                        break;
-                    }
-
-                    if (ch == '*') {
+                do {
+                    skip_to('*', '*', false);
+                    while (ch == '*') {
                         getc();
-                        if (ch == '/') {
-                            getc();
-                            break;
-                        }
                     }
-                }
+                } while (ch != '/' && ch != EOF);
 
-                if (ch != EOF) {
-                    next_token();
+                open = ch == EOF;
+                if (!open) {
+                    getc();
                 }
-
-                break;
+                goto again;
             }
 
             sym = SLASH;
@@ -152,115 +706,162 @@ void Lexer::next_token(bool ignore) {
             break;
         }
         case '#': {
-            do {
-                getc();
-            } while (ch != EOF && ch != '\n' && ch != '\r');
-
-            if (ch != EOF) {
-                next_token();
-            }
-
-            break;
+            skip_to('\n', '\r', false);
+            goto again;
         }
         case '"': {
-            std::string str;
-            getc();
+            unsigned first = line;
 
-            while (ch != '"') {
-                str += ch;
-                getc();
+            getc();
+            start = mark();
+            if (ch != '"' && ch != EOF) {
+                skip_to('"', '"', true);
             }
 
-            sym = STR;
-            str_val = str;
+            if (ch == EOF) {
+                line = first;
+                error("missing terminating '\"' character");
+            }
 
+            auto size = static_cast<std::size_t>(mark() - start); // the quotes are not part of the value
             getc();
-            break;
+
+            sym = STR;
+            text = {start, size};
+            return;
         }
         default: {
             if (isdigit(ch) != 0) {
-                std::string buf;
-
-                while ((isdigit(ch) != 0) || ch == '.') {
-                    buf += ch;
-                    getc();
-                }
+                sym = NUM_I;
 
-                if (strchr(buf.c_str(), '.') != nullptr) {
-                    sym = NUM_F;
-                    float_val = std::stod(buf);
-                }
-                else {
-                    sym = NUM_I;
-                    int_val = std::stoi(buf);
+                int next = ch == '0' ? lookahead() : EOF;
+                if (next == 'x' || next == 'X' || next == 'b' || next == 'B') {
+                    getc(); // radix prefix, the digits are checked by decode()
+                    do {
+                        getc();
+                    } while (isalnum(ch) != 0);
+                } else {
+                    while ((isdigit(ch) != 0) || ch == '.') {
+                        if (ch == '.') {
+                            sym = NUM_F;
+                        }
+                        getc();
+                    }
                 }
             } else if (isalpha(ch) != 0) {
-                std::string str;
-
                 while ((isalnum(ch) != 0) || ch == '_') {
-                    str += ch;
                     getc();
                 }
 
-                sym = -1;
+                int word = keyword({start, static_cast<std::size_t>(mark() - start)});
+                sym = word != -1 ? word : NAME;
+            } else {
+                error(std::string("stray '") + static_cast<char>(ch) + "' in program");
+            }
+        }
+    }
 
-                for (auto &&item : WORDS) {
-                    if (str == item.first) {
-                        sym = item.second;
-                    }
-                }
+    text = {start, static_cast<std::size_t>(mark() - start)};
+}
 
-                if (str == "index") {
-                    sym = ID;
-                    str_val = str;
-                }
+bool Lexer::var_defined(Symbol name) {
+    auto binding = symbols.find(name);
+    return binding != std::cend(symbols) && binding->second.var;
+}
 
-                for (auto &&item : vars) {
-                    if (str == item.first) {
-                        sym = ID;
-                        str_val = str;
-                    }
-                }
+bool Lexer::arr_defined(Symbol name) {
+    auto binding = symbols.find(name);
+    return binding != std::cend(symbols) && binding->second.array;
+}
 
-                for (auto &&item : functions) {
-                    if (str == item.first) {
-                        sym = FUNCTION_ID;
-                        str_val = str;
-                    }
-                }
+bool Lexer::fn_defined(Symbol name) {
+    auto binding = symbols.find(name);
+    return binding != std::cend(symbols) && binding->second.function;
+}
 
-                for (auto &&item : types) {
-                    if (str == item.first) {
-                        sym = USER_TYPE;
-                        str_val = str;
-                    }
-                }
+bool Lexer::type_defined(Symbol name) {
+    auto binding = symbols.find(name);
+    return binding != std::cend(symbols) && binding->second.type;
+}
 
-                if (sym == -1) {
-                    if (ignore) {
-                        sym = ID;
-                        str_val = str;
-                    } else {
-                        error("'" + str + "' was not declared in this scope");
-                    }
-                }
-            }
-        }
+const std::shared_ptr<types::Type> &Lexer::var(Symbol name) const {
+    const auto &t = symbols.at(name).var;
+    if (!t) {
+        throw std::out_of_range(name.str());
+    }
+    return t;
+}
+
+const std::shared_ptr<types::Type> &Lexer::function(Symbol name) const {
+    const auto &t = symbols.at(name).function;
+    if (!t) {
+        throw std::out_of_range(name.str());
+    }
+    return t;
+}
+
+const std::shared_ptr<types::AbstractType> &Lexer::type(Symbol name) const {
+    const auto &t = symbols.at(name).type;
+    if (!t) {
+        throw std::out_of_range(name.str());
     }
+    return t;
 }
 
-bool Lexer::var_defined(const std::string &name) {
-    return !(this->vars.find(name) == std::cend(this->vars));
+Lexer::Binding &Lexer::rebind(Symbol name) {
+    auto &binding = symbols[name];
+    if (log_declarations) {
+        declarations.push_back({name, binding, {}});
+    }
+    return binding;
+}
+
+void Lexer::declare_var(Symbol name, std::shared_ptr<types::Type> t) {
+    auto &binding = rebind(name);
+    var_scopes.declare(name, std::move(binding.var));
+    binding.var = std::move(t);
+}
+
+void Lexer::declare_array(Symbol name, std::shared_ptr<types::Type> t) {
+    auto &binding = rebind(name);
+    if (!binding.array) {
+        binding.array = std::move(t);
+    }
 }
 
-bool Lexer::arr_defined(const std::string &name) {
-    return !(this->arrays.find(name) == std::cend(this->arrays));
+void Lexer::declare_function(Symbol name, std::shared_ptr<types::Type> t) {
+    rebind(name).function = std::move(t);
 }
 
-bool Lexer::fn_defined(const std::string &name) {
-    return !(this->functions.find(name) == std::cend(this->functions));
+void Lexer::declare_type(Symbol name, std::shared_ptr<types::AbstractType> t) {
+    rebind(name).type = std::move(t);
 }
 
-bool Lexer::type_defined(const std::string &name) {
-    return !(this->types.find(name) == std::cend(this->types));
+void Lexer::forget_var(Symbol name) {
+    auto binding = symbols.find(name);
+    if (binding == std::end(symbols)) {
+        return;
+    }
+
+    if (log_declarations) {
+        declarations.push_back({name, binding->second, {}});
+    }
+    binding->second.var = nullptr;
+    if (binding->second.empty()) {
+        symbols.erase(binding);
+    }
+}
+
+void Lexer::enter_scope() {
+    var_scopes.push();
+}
+
+void Lexer::leave_scope() {
+    var_scopes.pop([this](Symbol name, std::shared_ptr<types::Type> previous) {
+        if (previous) {
+            rebind(name).var = std::move(previous);
+        } else {
+            forget_var(name);
+        }
+    });
 }
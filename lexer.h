@@ -6,30 +6,115 @@
 #define TURNIP2_LEXER_H
 
 #include "location.h"
+#include "scope.h"
+#include "source.h"
 #include "utilities.h"
 
+#include <cstdint>
 #include <vector>
-#include <fstream>
+#include <string_view>
 #include <unordered_map>
 #include <memory>
 
 using namespace turnip2;
 
+// Every token of a file, one array per field. Names are not classified yet:
+// resolve() does that when the parser consumes them, against the
+// declarations the parser has seen by then.
+struct TokenBuffer {
+    std::vector<unsigned char> kind;
+    std::vector<std::uint32_t> offset; // from the start of the input
+    std::vector<std::uint32_t> length;
+    std::vector<unsigned> line;
+    std::vector<unsigned> column;
+
+    std::size_t size() const { return kind.size(); }
+};
+
 class Lexer {
-    std::vector<char> code;
-    std::vector<char>::iterator iter;
+    const char *begin = nullptr;
+    const char *iter = nullptr;
+    const char *end = nullptr; // one past the last byte of the input, reading it yields EOF
+
+    int ch;
+    const char *start = nullptr; // first byte of the token being scanned
+    std::string_view text; // source text of the current token
+
+    // Streamed input: only a fixed window of it is in memory. A refill moves
+    // everything from 'start' on to the front of the window and reads more
+    // behind it, so a token cut by the end of the window stays contiguous.
+    Stream *input = nullptr;
+    std::vector<char> window;
+    bool exhausted = false;
+
+    TokenBuffer tokens;
+    const Lexer *origin = nullptr; // whose tokens are read instead, see attach()
+    std::size_t cursor = 0;
+    std::size_t stop = SIZE_MAX; // tokens from here on read as EOI
+    bool buffered = false;
+    bool open = false; // the input ended inside a block comment
+
+    Scopes<std::shared_ptr<types::Type>> var_scopes; // variables shadowed by the open scopes
+
+    // a slice of the input lexed on its own by tokenize()
+    struct Chunk {
+        const char *from;
+        const char *to;
+        TokenBuffer tokens;
+        unsigned first_line = 1; // the line the tokens and errors count from
+        bool clean = false; // ended on a token boundary without errors
+    };
 
-    char ch;
     void error(const std::string &e);
     void getc();
+    int lookahead(); // byte after ch without consuming it, EOF at the end of the input
+    const char *mark() const;
+    bool fill(); // refill the window from the stream, false once it is exhausted
+    void advance(const char *to); // skip to 'to' in one step, counting the line breaks on the way
+    void skip_to(char a, char b, bool keep); // advance to the next a or b after ch, across refills
+    void scan();
+    void decode(bool ignore);
+    void resolve(bool ignore);
+    void lex_chunk(Chunk &chunk, bool report, unsigned first_line = 1);
+    const TokenBuffer &buffer() const { return origin != nullptr ? origin->tokens : tokens; }
 
 public:
-    void load(std::vector<char> c);
+    void load(std::string_view c);
+    void stream(Stream &in); // lex 'in' on demand through a 1 MiB window instead of loading it
+    void tokenize(unsigned threads = 1); // lex the loaded input up front, next_token then walks the buffer; no-op for streams
     void next_token(bool ignore = false);
-    bool var_defined(const std::string &name);
-    bool arr_defined(const std::string &name);
-    bool fn_defined(const std::string &name);
-    bool type_defined(const std::string &name);
+    int peek(std::size_t n = 1) const; // raw kind of the n-th token after the current one, -1 when not tokenized
+
+    // Reads the tokens of 'other' with a copy of its symbol table, to parse
+    // parts of one input on several threads. 'other' has to outlive this
+    // lexer and leave its tokens alone meanwhile.
+    void attach(const Lexer &other);
+
+    // Random access to a tokenized input, for incremental and parallel parsing.
+    bool tokenized() const { return buffered; }
+    bool streamed() const { return input != nullptr; }
+    std::size_t position() const { return cursor - 1; } // buffer index of the current token
+    void seek(std::size_t token, std::size_t last = SIZE_MAX) { cursor = token; stop = last; } // next_token continues with 'token', 'last' and the ones behind it read as EOI
+    std::size_t skip_braces(); // the current token being '{', next_token continues behind its '}'; returns where that is
+    std::size_t skip_member(); // the current token starting the body of a method, next_token continues at the next member of its class or the class's '}'; returns where that is
+    std::size_t token_count() const { return buffer().size(); }
+    int token_kind(std::size_t token) const { return buffer().kind[token]; }
+    std::size_t token_offset(std::size_t token) const { return buffer().offset[token]; }
+    unsigned token_line(std::size_t token) const { return buffer().line[token]; }
+
+    // The input was edited inside c[from, to), 'c' being the whole new
+    // input: the tokens [first, last) of the buffer make way for those lexed
+    // from there, the ones behind move with the text. 'from' is the start of
+    // a line, 'to' is where token 'last' starts now, below the edit and on a
+    // line it leaves alone; c.size() and token_count() when the edit reaches
+    // the end. False, with the buffer untouched, when the new text does not
+    // end between two tokens at 'to' (it opens a comment or string there).
+    bool relex(std::string_view c, std::size_t first, std::size_t last, std::size_t from, std::size_t to);
+
+    bool var_defined(Symbol name);
+    bool arr_defined(Symbol name);
+    bool fn_defined(Symbol name);
+    bool type_defined(Symbol name);
 
     int sym;
 
@@ -37,18 +122,57 @@ public:
     unsigned column = 1;
     Location location;
 
-    int int_val;
+    std::int64_t int_val;
     double float_val;
     std::string str_val;
+    Symbol name; // interned spelling of the last name token
+
+    // Everything declared under one name. Identifiers are classified with a
+    // single lookup here instead of scanning every declaration table.
+    struct Binding {
+        std::shared_ptr<types::Type> var;
+        std::shared_ptr<types::Type> array;
+        std::shared_ptr<types::Type> function;
+        std::shared_ptr<types::AbstractType> type;
+
+        bool empty() const { return !var && !array && !function && !type; }
+    };
+
+    std::unordered_map<Symbol, Binding> symbols;
+
+    // Every change of a binding while log_declarations is set, with what
+    // the name was bound to before it; 'after' is left to the reader.
+    struct Declaration {
+        Symbol name;
+        Binding before;
+        Binding after;
+    };
+
+    bool log_declarations = false;
+    std::vector<Declaration> declarations;
+
+    // lookups throw std::out_of_range when the name has no such declaration
+    const std::shared_ptr<types::Type> &var(Symbol name) const;
+    const std::shared_ptr<types::Type> &function(Symbol name) const;
+    const std::shared_ptr<types::AbstractType> &type(Symbol name) const;
+
+    void declare_var(Symbol name, std::shared_ptr<types::Type> t); // shadows the variable of an enclosing scope
+    void declare_array(Symbol name, std::shared_ptr<types::Type> t);
+    void declare_function(Symbol name, std::shared_ptr<types::Type> t); // replaces a declaration, the parser reports duplicates
+    void declare_type(Symbol name, std::shared_ptr<types::AbstractType> t);
+    void forget_var(Symbol name);
 
-    std::unordered_map<std::string, std::shared_ptr<types::AbstractType>> types;
-    std::unordered_map<std::string, std::shared_ptr<types::Type>> vars;
-    std::unordered_map<std::string, std::shared_ptr<types::Type>> arrays;
-    std::unordered_map<std::string, std::shared_ptr<types::Type>> functions;
+    // variables declared between the two are forgotten by leave_scope()
+    void enter_scope();
+    void leave_scope();
 
+private:
+    Binding &rebind(Symbol name); // the binding of 'name', about to change
+
+public:
     enum token_types {
         USER_TYPE, POINT, INHERIT,
-        NUM_I, NUM_F, STR, ID, FUNCTION_ID,
+        NUM_I, NUM_F, STR, ID, FUNCTION_ID, NAME,
         ARRAY, OF, INT, FLOAT, STRING, BOOL,
         CLASS, PRIVATE, PUBLIC, PROTECTED, OVERRIDE,
         IF, ELSE,
@@ -65,37 +189,6 @@ public:
         COMMA, EOI
     };
 
-    std::unordered_map<std::string, int> WORDS = {
-        {"array",     ARRAY},
-        {"of",        OF},
-        {"int",       INT},
-        {"float",     FLOAT},
-        {"string",    STRING},
-        {"bool",      BOOL},
-        {"class",     CLASS},
-        {"private",   PRIVATE},
-        {"public",    PUBLIC},
-        {"protected", PROTECTED},
-        {"override",  OVERRIDE},
-        {"if",        IF},
-        {"else",      ELSE},
-        {"while",     WHILE},
-        {"do",        DO},
-        {"repeat",    REPEAT},
-        {"var",       VAR},
-        {"del",       DELETE},
-        {"is",        IS},
-        {"and",       AND},
-        {"or",        OR},
-        {"not",       NOT},
-        {"true",      TRUE},
-        {"false",     FALSE},
-        {"println",   PRINTLN},
-        {"input",     INPUT},
-        {"function",  FUNCTION},
-        {"return",    RETURN}
-    };
-
 };
 
 
@@ -7,8 +7,8 @@
 
 
 struct Location {
-    unsigned line;
-    unsigned column;
+    unsigned line = 0;
+    unsigned column = 0;
 };
 
 
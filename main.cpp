@@ -1,15 +1,20 @@
+#include "source.h"
 #include "lexer.h"
 #include "parser.h"
+#include "cache.h"
+#include "resolver.h"
 #include "generator.h"
+#include "backend.h"
 
 #include "llvm/IR/Verifier.h"
 #include "llvm/Support/FileSystem.h"
-#include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
-#include "llvm/Target/TargetMachine.h"
 
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
-#include <unistd.h>
+#include <thread>
+#include <vector>
 
 class InputParser {
 public:
@@ -21,7 +26,10 @@ public:
 
         for (int i = 1; i < argc; ++i) {
             if (std::find(std::begin(supported_options), std::end(supported_options), std::string(argv[i]))
-                != std::end(supported_options) || std::string(argv[i-1]) == "-o" || i == 1) {
+                != std::end(supported_options) || std::string(argv[i-1]) == "-o" || std::string(argv[i-1]) == "-ast-cache" || std::string(argv[i-1]) == "-j" || i == 1 ||
+                std::any_of(std::begin(valued_options), std::end(valued_options), [&](const std::string &option) {
+                    return std::string(argv[i]).compare(0, option.size(), option) == 0; // the value follows '='
+                })) {
                 tokens.emplace_back(std::string(argv[i]));
             } else {
                 std::cerr << "error: option '" << argv[i] << "' is not supported!" << std::endl;
@@ -30,12 +38,20 @@ public:
     }
 
     void show_usage() {
-        std::cout << "USAGE: turnip2 <input> [options]" << std::endl
+        std::cout << "USAGE: turnip2 <input|-> [options]" << std::endl
                 << "OPTIONS:" << std::endl
+                << "\t -           read the program from stdin as it arrives; a class or function" << std::endl
+                << "\t             then has to be defined above its first use" << std::endl
                 << "\t -g          generate source-level debug information" << std::endl
                 << "\t -emit-llvm  emit LLVM IR for source inputs" << std::endl
                 << "\t -o <file>   write output to <file>" << std::endl
-                << "\t -O          optimize code to reduce size and time of execution" << std::endl
+                << "\t -ast-cache <dir>  reuse the trees of unchanged inputs, kept in <dir>" << std::endl
+                << "\t -j <n>      generate and emit code on <n> threads, one module and object file each (default: 1;" << std::endl
+                << "\t             1 with -emit-llvm); more than one module turns off whole-program optimization" << std::endl
+                << "\t -O<level>   optimize the program as a whole: -O0 (default), -O1, -O2, -O3 or -Os; -O is -O2" << std::endl
+                << "\t -march=<cpu>     make code for <cpu>; 'native' is this machine, with every feature it has" << std::endl
+                << "\t -mcpu=<cpu>      the same, and it wins over -march" << std::endl
+                << "\t -mattr=<list>    features to use or not on top of those, as +avx2,-fma" << std::endl
                 << "\t -S          only run compilation steps" << std::endl;
     }
 
@@ -59,113 +75,183 @@ public:
         return std::find(std::cbegin(tokens), std::cend(tokens), option) != std::cend(tokens);
     }
 
+    // the one of 'options' given last on the command line, empty if none is
+    std::string last_of(const std::vector<std::string> &options) const {
+        auto itr = std::find_first_of(std::crbegin(tokens), std::crend(tokens), std::cbegin(options), std::cend(options));
+        return itr != std::crend(tokens) ? *itr : std::string();
+    }
+
 private:
     std::vector<std::string> tokens;
     const std::vector<std::string> supported_options = {
             "-g",
             "-emit-llvm",
             "-o",
+            "-ast-cache",
+            "-j",
             "-O",
+            "-O0",
+            "-O1",
+            "-O2",
+            "-O3",
+            "-Os",
             "-S"
     };
+    const std::vector<std::string> valued_options = {
+            "-march=",
+            "-mcpu=",
+            "-mattr="
+    };
 };
 
-void generateObject(Module *m, std::string &out) {
-    InitializeNativeTarget();
-    InitializeNativeTargetAsmParser();
-    InitializeNativeTargetAsmPrinter();
-
-    auto targetTriple = sys::getDefaultTargetTriple();
-    m->setTargetTriple(targetTriple);
-
-    std::string error;
-    auto target = TargetRegistry::lookupTarget(targetTriple, error);
-
-    if (target == nullptr) {
-        errs() << error;
-        return;
-    }
-
-    auto CPU = "generic";
-    auto features = "";
-
-    TargetOptions opt;
-    auto RM = Optional<Reloc::Model>();
-    auto theTargetMachine = target->createTargetMachine(targetTriple, CPU, features, opt, RM);
-
-    m->setDataLayout(theTargetMachine->createDataLayout());
-
-    std::error_code EC;
-    raw_fd_ostream dest((out.find('.') != std::string::npos) ? (out.substr(0, std::string(out).find_last_of('.')) + ".o") : (out + ".o"), EC, sys::fs::F_None);
-
-    if (EC) {
-        errs() << "Could not open file: " << EC.message();
-        return;
-    }
-
-    legacy::PassManager pass;
-    auto fileType = TargetMachine::CGFT_ObjectFile;
-
-    if (theTargetMachine->addPassesToEmitFile(pass, dest, fileType)) {
-        errs() << "Couldn't emit a file of this type";
-        return;
-    }
+int main(int argc, char **argv) {
+    InputParser params(argc, argv);
 
-    pass.run(*m);
-    dest.flush();
+    try {
+        // "-" streams stdin through the lexer's window, files are mapped and
+        // scanned in place; either must outlive the lexer
+        std::unique_ptr<Stream> stream;
+        std::unique_ptr<Source> source;
 
-#if defined(__linux__)
-    execl("/usr/bin/gcc", "/usr/bin/gcc", std::string((out.find('.') != std::string::npos) ? (out.substr(0, std::string(out).find_last_of('.')) + ".o") : (out + ".o")).c_str(), std::string("-o" + out).c_str(), NULL);
-#endif
+        Lexer *lexer = new Lexer;
+        if (std::string(argv[1]) == "-") {
+            stream = std::make_unique<Stream>(argv[1]);
+            lexer->stream(*stream);
+        } else {
+            source = std::make_unique<Source>(argv[1]);
+        }
 
-}
+        // a file compiled before with the same text skips lexing and parsing
+        std::unique_ptr<AstCache> cache;
+        Node *ast = nullptr;
+        if (source && !params.get_option("-ast-cache").empty()) {
+            cache = std::make_unique<AstCache>(params.get_option("-ast-cache"));
+            ast = cache->load(source->view());
+        }
 
-int main(int argc, char **argv) {
-    InputParser params(argc, argv);
-    std::ifstream in(argv[1]);
+        Arena arena; // every node of the tree, freed together when compilation ends
+        if (ast == nullptr) {
+            if (source) {
+                lexer->load(source->view());
+                lexer->tokenize(std::thread::hardware_concurrency());
+            }
 
-    char c;
-    std::vector<char> code;
+            Parser *parser = new Parser(lexer, &arena, std::thread::hardware_concurrency());
+            ast = parser->parse();
 
-    while (!in.eof()) {
-        in.get(c);
-        code.emplace_back(c);
-    }
-    code.emplace_back(EOF);
+            if (cache) {
+                cache->store(source->view(), ast);
+            }
+        }
 
-    try {
-        Lexer *lexer = new Lexer;
-        lexer->load(code);
+        Resolver resolver;
+        resolver.resolve(ast); // binds every variable to a slot of its function
 
-        Parser *parser = new Parser(lexer);
-        std::shared_ptr<Node> ast = parser->parse();
+        // the last level given wins, as with gcc; -O is -O2
+        optimization_level level = O0;
+        std::string given = params.last_of({"-O", "-O0", "-O1", "-O2", "-O3", "-Os"});
+        const char *levels[] = {"-O0", "-O1", "-O2", "-O3", "-Os"};
+        for (int l = O0; l <= Os; l++) {
+            if (given == levels[l]) {
+                level = static_cast<optimization_level>(l);
+            }
+        }
+        if (given == "-O") {
+            level = O2;
+        }
 
-        bool optimize = params.option_exists("-O");
         bool generateDI = params.option_exists("-g");
-        if (optimize && generateDI)
+        if (level != O0 && generateDI)
             generateDI = false;
 
-        Generator *generator = new Generator(optimize, generateDI, argv[1]);
+        unsigned threads = 1; // one module, optimized as a whole, the same on every machine
+        if (!params.get_option("-j").empty()) {
+            threads = static_cast<unsigned>(std::strtoul(params.get_option("-j").c_str(), nullptr, 10));
+        }
+        if (params.option_exists("-emit-llvm")) {
+            threads = 1; // the IR is printed as one module
+        }
+
+        ParallelGenerator *generator = new ParallelGenerator(generateDI, argv[1], threads);
         generator->generate(ast);
+        auto &units = generator->units;
 
         std::string output = "a.out";
         if (!params.get_option("-o").empty()) {
             output = params.get_option("-o");
         }
 
+        InitializeNativeTarget();
+        InitializeNativeTargetAsmParser();
+        InitializeNativeTargetAsmPrinter();
+
+        Processor processor;
+        std::string cpu = !params.get_option("-mcpu=").empty() ? params.get_option("-mcpu=") : params.get_option("-march=");
+        if (cpu == "native") {
+            processor = hostProcessor();
+        } else if (!cpu.empty()) {
+            processor.cpu = cpu;
+        }
+        if (!params.get_option("-mattr=").empty()) {
+            processor.features += (processor.features.empty() ? "" : ",") + params.get_option("-mattr=");
+        }
+
+        // every module is optimized, then written, with a target machine of its own and on a thread of its own
+        std::vector<std::unique_ptr<TargetMachine>> machines(units.size());
+        std::vector<std::string> errors(units.size());
+        auto failed = [&errors] {
+            for (auto &&error : errors) {
+                if (!error.empty()) {
+                    errs() << error << "\n";
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        forEachModule(units.size(), [&](std::size_t i) {
+            Module *m = units[i]->module.get();
+            machines[i] = createTargetMachine(level, processor, errors[i]);
+            if (machines[i] == nullptr) {
+                return;
+            }
+
+            m->setTargetTriple(machines[i]->getTargetTriple().str());
+            m->setDataLayout(machines[i]->createDataLayout());
+            optimizeModule(m, machines[i].get(), level, units.size() == 1);
+        });
+        if (failed()) {
+            return 1;
+        }
+
         if (params.option_exists("-emit-llvm")) {
             std::string file = std::string(argv[1]).substr(0, std::string(argv[1]).find_last_of('.')) + ".s";
             std::error_code EC;
-            raw_fd_ostream dest(file, EC, sys::fs::F_None);
-            generator->module.get()->print(dest, nullptr);
+            raw_fd_ostream dest(file, EC, sys::fs::OF_None);
+            units.front()->module.get()->print(dest, nullptr);
             dest.close();
         }
 
         if (!params.option_exists("-S")) {
-            generateObject(generator->module.get(), output);
+            // one object file per module: <output>.o, <output>.1.o, ...; a
+            // module is the same for the same number of threads
+            std::string base = (output.find('.') != std::string::npos) ? output.substr(0, output.find_last_of('.')) : output;
+            std::vector<std::string> objects;
+            for (std::size_t i = 0; i != units.size(); i++) {
+                objects.push_back(base + (i != 0 ? "." + std::to_string(i) : "") + ".o");
+            }
+
+            forEachModule(units.size(), [&](std::size_t i) {
+                errors[i] = generateObject(units[i]->module.get(), machines[i].get(), objects[i]);
+            });
+            if (failed()) {
+                return 1;
+            }
 
-            if (generateDI) {
-                generator->dbuilder->finalize();
+            std::string error = link(objects, output);
+            if (!error.empty()) {
+                errs() << error << "\n";
+                return 1;
             }
         }
     }
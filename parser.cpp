@@ -4,32 +4,46 @@
 
 #include "parser.h"
 
-#include <iostream>
+#include <array>
+#include <atomic>
+#include <exception>
 #include <algorithm>
+#include <memory>
+#include <thread>
+#include <unordered_map>
 
 void Parser::error(const std::string &e) {
     throw std::string(std::to_string(lexer->line) + " -> " + e);
 }
 
-std::shared_ptr<Node> Parser::term() {
-    std::shared_ptr<Node> x;
+// types the call 'x' by what 'member' returns, the member has to be a method
+void Parser::method_call(Node *x, const types::Member *member) {
+    if (member->kind != types::Member::METHOD) {
+        error("member '" + x->property_name.str() + "' of class '" + x->user_type.str() + "' is not a method");
+    }
+
+    x->value_type = member->type->value_type;
+    x->user_type = member->type->user_type_name;
+}
+
+Node *Parser::primary() {
+    Node *x = nullptr;
 
     if (lexer->sym == Lexer::ID) {
-        x = std::make_shared<Node>(Node::VAR_ACCESS);
+        x = arena->make<Node>(Node::VAR_ACCESS);
         x->location = lexer->location;
-        x->var_name = lexer->str_val;
+        x->var_name = lexer->name;
 
         lexer->next_token();
 
-        x->value_type = lexer->vars.at(x->var_name)->value_type;
-        x->user_type = lexer->vars.at(x->var_name)->user_type_name;
+        x->value_type = lexer->var(x->var_name)->value_type;
+        x->user_type = lexer->var(x->var_name)->user_type_name;
         if (lexer->sym == Lexer::L_ACCESS) {
             x->kind = Node::ARRAY_ACCESS;
             lexer->next_token();
             x->o1 = sum();
 
             if (lexer->sym != Lexer::R_ACCESS) {
-                std::cerr << lexer->sym << std::endl;
                 error("expected ']'");
             }
 
@@ -39,66 +53,43 @@ std::shared_ptr<Node> Parser::term() {
             x->kind = Node::PROPERTY_ACCESS;
             lexer->next_token(true);
 
-            x->property_name = lexer->str_val;
-
-            try {
-                lexer->types.at(lexer->vars.at(x->var_name)->user_type_name)->properties.at(x->property_name);
-            } catch (std::out_of_range) {
-                try {
-                    lexer->types.at(lexer->vars.at(x->var_name)->user_type_name)->methods.at(x->property_name);
-                }
-                catch(std::out_of_range) {
-                    error(
-                            "object '" +
-                            x->var_name +
-                            "' of class '" +
-                            lexer->vars.at(x->var_name)->user_type_name +
-                            "' has no member named '" +
-                            x->property_name + "'"
-                    );
-                }
+            x->property_name = lexer->name;
+
+            const auto &object = lexer->var(x->var_name);
+            const types::Member *member = lexer->type(object->user_type_name)->find(x->property_name);
+            if (member == nullptr) {
+                error(
+                        "object '" +
+                        x->var_name.str() +
+                        "' of class '" +
+                        object->user_type_name.str() +
+                        "' has no member named '" +
+                        x->property_name.str() + "'"
+                );
             }
 
-            x->value_type = lexer->vars.at(x->var_name)->value_type;
-            x->user_type = lexer->vars.at(x->var_name)->user_type_name;
+            x->value_type = object->value_type;
+            x->user_type = object->user_type_name;
 
             lexer->next_token();
 
             if (lexer->sym == Lexer::L_PARENT) {
-                x->kind = Node::METHOD_CALL;
-
-                x->value_type = lexer->types.at(x->user_type)->methods.at(x->property_name)->type->value_type;
-                x->user_type = lexer->types.at(x->user_type)->methods.at(x->property_name)->type->user_type_name;
-
-                lexer->next_token();
-                while (true) {
-                    if (lexer->sym == Lexer::R_PARENT) {
-                        break;
-                    }
-
-                    x->func_call_args.emplace_back(sum());
-
-                    if (lexer->sym == Lexer::R_PARENT) {
-                        break;
-                    }
-
-                    if (lexer->sym != Lexer::COMMA) {
-                        error("expected ',' or ')' in arguments list");
-                    }
+                Node *receiver = arena->make<Node>(Node::VAR_ACCESS); // an operand, like the call of FUNC_OBJ_METHOD_CALL
+                receiver->location = x->location;
+                receiver->var_name = x->var_name;
+                receiver->value_type = x->value_type;
+                receiver->user_type = x->user_type;
 
-                    lexer->next_token();
-                }
-
-                if (lexer->sym != Lexer::R_PARENT) {
-                    error("expected ')' in arguments list");
-                }
+                x->kind = Node::METHOD_CALL;
+                x->o1 = receiver;
+                method_call(x, member);
 
-                lexer->next_token();
+                x->func_call_args = call_args();
             }
         }
 
     } else if (lexer->sym == Lexer::NUM_I) {
-        x = std::make_shared<Node>(Node::CONST);
+        x = arena->make<Node>(Node::CONST);
         x->location = lexer->location;
         x->value_type = Node::INTEGER;
 
@@ -106,7 +97,7 @@ std::shared_ptr<Node> Parser::term() {
 
         lexer->next_token();
     } else if (lexer->sym == Lexer::NUM_F) {
-        x = std::make_shared<Node>(Node::CONST);
+        x = arena->make<Node>(Node::CONST);
         x->location = lexer->location;
         x->value_type = Node::FLOATING;
 
@@ -114,15 +105,15 @@ std::shared_ptr<Node> Parser::term() {
 
         lexer->next_token();
     } else if (lexer->sym == Lexer::STR) {
-        x = std::make_shared<Node>(Node::CONST);
+        x = arena->make<Node>(Node::CONST);
         x->location = lexer->location;
         x->value_type = Node::STRING;
 
-        x->str_val = lexer->str_val;
+        x->str_val = arena->copy(lexer->str_val);
 
         lexer->next_token();
     } else if (lexer->sym == Lexer::TRUE) {
-        x = std::make_shared<Node>(Node::CONST);
+        x = arena->make<Node>(Node::CONST);
         x->location = lexer->location;
         x->value_type = Node::BOOL;
 
@@ -130,7 +121,7 @@ std::shared_ptr<Node> Parser::term() {
 
         lexer->next_token();
     } else if (lexer->sym == Lexer::FALSE) {
-        x = std::make_shared<Node>(Node::CONST);
+        x = arena->make<Node>(Node::CONST);
         x->location = lexer->location;
         x->value_type = Node::BOOL;
 
@@ -138,46 +129,23 @@ std::shared_ptr<Node> Parser::term() {
 
         lexer->next_token();
     } else if (lexer->sym == Lexer::FUNCTION_ID) {
-        x = std::make_shared<Node>(Node::FUNCTION_CALL);
+        x = arena->make<Node>(Node::FUNCTION_CALL);
         x->location = lexer->location;
-        x->value_type = lexer->functions.at(lexer->str_val)->value_type;
-        x->user_type = lexer->functions.at(lexer->str_val)->user_type_name;
-        x->var_name = lexer->str_val;
+        x->value_type = lexer->function(lexer->name)->value_type;
+        x->user_type = lexer->function(lexer->name)->user_type_name;
+        x->var_name = lexer->name;
 
         lexer->next_token();
         if (lexer->sym != Lexer::L_PARENT) {
             error("expected '(' in arguments list");
         }
 
-        lexer->next_token();
-        while (true) {
-            if (lexer->sym == Lexer::R_PARENT) {
-                break;
-            }
-
-            x->func_call_args.emplace_back(sum());
-
-            if (lexer->sym == Lexer::R_PARENT) {
-                break;
-            }
-
-            if (lexer->sym != Lexer::COMMA) {
-                error("expected ',' or ')' in arguments list");
-            }
-
-            lexer->next_token();
-        }
-
-        if (lexer->sym != Lexer::R_PARENT) {
-            error("expected ')' in arguments list");
-        }
-
-        lexer->next_token();
+        x->func_call_args = call_args();
 
         if (lexer->sym == Lexer::POINT) {
-            std::shared_ptr<Node> t = std::move(x);
+            Node *t = x;
 
-            x = std::make_shared<Node>(Node::FUNC_OBJ_PROPERTY_ACCESS);
+            x = arena->make<Node>(Node::FUNC_OBJ_PROPERTY_ACCESS);
             x->location = lexer->location;
             x->o1 = t;
             x->var_name = t->var_name;
@@ -185,386 +153,330 @@ std::shared_ptr<Node> Parser::term() {
             x->user_type = t->user_type;
             lexer->next_token(true);
 
-            x->property_name = lexer->str_val;
-
-            try {
-                lexer->types.at(lexer->functions.at(x->var_name)->user_type_name)->properties.at(x->property_name);
-            } catch (std::out_of_range) {
-                try {
-                    lexer->types.at(lexer->functions.at(x->var_name)->user_type_name)->methods.at(x->property_name);
-                }
-                catch(std::out_of_range) {
-                    error(
-                            "object returned by function '" +
-                            x->var_name +
-                            "' of class '" +
-                            lexer->functions.at(x->var_name)->user_type_name +
-                            "' has no member named '" +
-                            x->property_name + "'"
-                    );
-                }
+            x->property_name = lexer->name;
+
+            const auto &object = lexer->function(x->var_name);
+            const types::Member *member = lexer->type(object->user_type_name)->find(x->property_name);
+            if (member == nullptr) {
+                error(
+                        "object returned by function '" +
+                        x->var_name.str() +
+                        "' of class '" +
+                        object->user_type_name.str() +
+                        "' has no member named '" +
+                        x->property_name.str() + "'"
+                );
             }
 
-            x->value_type = lexer->functions.at(x->var_name)->value_type;
-            x->user_type = lexer->functions.at(x->var_name)->user_type_name;
+            x->value_type = object->value_type;
+            x->user_type = object->user_type_name;
 
             lexer->next_token();
 
             if (lexer->sym == Lexer::L_PARENT) {
                 x->kind = Node::FUNC_OBJ_METHOD_CALL;
+                method_call(x, member);
 
-                x->value_type = lexer->types.at(x->user_type)->methods.at(x->property_name)->type->value_type;
-                x->user_type = lexer->types.at(x->user_type)->methods.at(x->property_name)->type->user_type_name;
-
-                lexer->next_token();
-                while (true) {
-                    if (lexer->sym == Lexer::R_PARENT) {
-                        break;
-                    }
-
-                    x->func_call_args.emplace_back(sum());
-
-                    if (lexer->sym == Lexer::R_PARENT) {
-                        break;
-                    }
-
-                    if (lexer->sym != Lexer::COMMA) {
-                        error("expected ',' or ')' in arguments list");
-                    }
-
-                    lexer->next_token();
-                }
-
-                if (lexer->sym != Lexer::R_PARENT) {
-                    error("expected ')' in arguments list");
-                }
-
-                lexer->next_token();
+                x->func_call_args = call_args();
             }
         }
     } else if (lexer->sym == Lexer::USER_TYPE) {
-        x = std::make_shared<Node>(Node::OBJECT_CONSTRUCT);
+        x = arena->make<Node>(Node::OBJECT_CONSTRUCT);
         x->location = lexer->location;
         x->value_type = Node::USER;
-        x->user_type = lexer->str_val;
-        x->var_name = lexer->str_val;
+        x->user_type = lexer->name;
+        x->var_name = lexer->name;
 
         lexer->next_token();
         if (lexer->sym != Lexer::L_PARENT) {
             error("expected '(' in arguments list");
         }
 
-        lexer->next_token();
-        while (true) {
-            if (lexer->sym == Lexer::R_PARENT) {
-                break;
-            }
-
-            x->func_call_args.emplace_back(sum());
+        x->func_call_args = call_args();
 
-            if (lexer->sym == Lexer::R_PARENT) {
-                break;
-            }
+    } else {
+        error("expected operand");
+    }
 
-            if (lexer->sym != Lexer::COMMA) {
-                error("expected ',' or ')' in arguments list");
-            }
+    return x;
+}
 
-            lexer->next_token();
-        }
+NodeList Parser::call_args() {
+    std::vector<Node *> args;
 
-        if (lexer->sym != Lexer::R_PARENT) {
-            error("expected ')' in arguments list");
+    lexer->next_token();
+    while (true) {
+        if (lexer->sym == Lexer::R_PARENT) {
+            break;
         }
 
-        lexer->next_token();
+        args.emplace_back(sum());
 
-    } else {
-        x = paren_expr();
-    }
+        if (lexer->sym == Lexer::R_PARENT) {
+            break;
+        }
 
-    if (lexer->sym == Lexer::STAR || lexer->sym == Lexer::SLASH) {
-        int kind = 0;
-        switch (lexer->sym) {
-            case Lexer::STAR:
-                kind = Node::MUL;
-                break;
-            case Lexer::SLASH:
-                kind = Node::DIV;
-                break;
+        if (lexer->sym != Lexer::COMMA) {
+            error("expected ',' or ')' in arguments list");
         }
+
         lexer->next_token();
+    }
 
-        auto t = x;
-        x = std::make_shared<Node>(kind);
-        x->location = lexer->location;
-        x->o1 = t;
-        x->o2 = term();
+    if (lexer->sym != Lexer::R_PARENT) {
+        error("expected ')' in arguments list");
     }
 
-    return x;
+    lexer->next_token();
+    return {arena->copy(args.data(), args.size()), static_cast<std::uint32_t>(args.size())};
 }
 
-std::shared_ptr<Node> Parser::sum() {
-    std::shared_ptr<Node> t, x = term();
-
-    while (lexer->sym == Lexer::PLUS || lexer->sym == Lexer::MINUS) {
-        t = x;
+// statements up to 'end', which is left for the caller to consume
+NodeList Parser::block(int end) {
+    std::vector<Node *> statements;
 
-        unsigned short kind = 255;
-        switch (lexer->sym) {
-            case Lexer::PLUS: {
-                kind = Node::ADD;
-                break;
-            }
-            case Lexer::MINUS:
-                kind = Node::SUB;
-                break;
+    while (lexer->sym != end) {
+        if (lexer->sym == Lexer::EOI) {
+            error("expected '}'");
         }
-        x = std::make_shared<Node>(kind);
-        x->location = lexer->location;
-
-        lexer->next_token();
 
-        x->o1 = t;
-        x->o2 = term();
-
-        x->value_type = x->o2->value_type;
+        statements.emplace_back(statement());
     }
 
-    return x;
+    return {arena->copy(statements.data(), statements.size()), static_cast<std::uint32_t>(statements.size())};
 }
 
-std::shared_ptr<Node> Parser::test() {
-    std::shared_ptr<Node> t;
-    std::shared_ptr<Node> x = sum();
+namespace {
+    struct Binary {
+        unsigned short kind = 0;
+        unsigned char precedence = Parser::NONE; // NONE: the token is no binary operator
+        bool right = false; // right-associative
+        bool typed = false; // the result has the type of the right operand
+
+        // two-token spellings such as '<' '=': when 'second' follows, the operator is 'second_kind'
+        int second = -1;
+        unsigned short second_kind = 0;
+    };
+
+    const std::array<Binary, Lexer::EOI + 1> binary_operators = [] {
+        std::array<Binary, Lexer::EOI + 1> table{};
+
+        table[Lexer::STAR] = {Node::MUL, Parser::MULTIPLICATIVE};
+        table[Lexer::SLASH] = {Node::DIV, Parser::MULTIPLICATIVE};
+        table[Lexer::PLUS] = {Node::ADD, Parser::ADDITIVE, false, true};
+        table[Lexer::MINUS] = {Node::SUB, Parser::ADDITIVE, false, true};
+        table[Lexer::LESS] = {Node::LESS, Parser::COMPARISON, false, false, Lexer::EQUAL, Node::LESS_EQUAL};
+        table[Lexer::MORE] = {Node::MORE, Parser::COMPARISON, false, false, Lexer::EQUAL, Node::MORE_EQUAL};
+        table[Lexer::IS] = {Node::EQUAL, Parser::COMPARISON, false, false, Lexer::NOT, Node::NOT_EQUAL};
+        table[Lexer::AND] = {Node::AND, Parser::CONJUNCTION, true};
+        table[Lexer::OR] = {Node::OR, Parser::DISJUNCTION, true};
+        table[Lexer::EQUAL] = {Node::SET, Parser::ASSIGNMENT, true};
+
+        return table;
+    }();
+}
 
-    switch (lexer->sym) {
-        case Lexer::LESS: {
-            lexer->next_token();
+Node *Parser::sum() {
+    return expression(ADDITIVE);
+}
 
-            std::vector<std::shared_ptr<Node>> operands = { x };
-            std::vector<unsigned> operations;
+Node *Parser::expr() {
+    return expression(ASSIGNMENT);
+}
 
-            if (lexer->sym == Lexer::EQUAL) {
-                lexer->next_token();
-                operations.emplace_back(Node::LESS_EQUAL);
-            } else if (lexer->sym == Lexer::ID || lexer->sym == Lexer::FUNCTION_ID
-                || lexer->sym == Lexer::NUM_I || lexer->sym == Lexer::NUM_F || lexer->sym == Lexer::STR) {
-                operations.emplace_back(Node::LESS);
+// Operator precedence parsing with explicit stacks: operands and pending
+// operators of every nesting level share 'operands' and 'operators', so
+// parentheses cost no C++ recursion, only calls and indices do.
+Node *Parser::expression(Precedence lowest) {
+    std::size_t operator_base = operators.size();
+    unsigned open = 0; // parentheses opened by this call and not closed yet
+
+    while (true) {
+        while (lexer->sym == Lexer::NOT || lexer->sym == Lexer::MINUS || lexer->sym == Lexer::L_PARENT) {
+            if (lexer->sym == Lexer::NOT) {
+                operators.push_back({Node::NOT, NEGATION, true, false, lexer->location});
+            } else if (lexer->sym == Lexer::MINUS) {
+                operators.push_back({Node::SUB, SIGN, true, true, lexer->location});
             } else {
-                error("expected '=' or operand");
+                operators.push_back({Node::EMPTY, NONE, false, false, lexer->location});
+                open++;
             }
+            lexer->next_token();
+        }
 
-            while (true) {
-                operands.emplace_back(sum());
-
-                if (lexer->sym == Lexer::LESS) {
-                    lexer->next_token();
-
-                    if (lexer->sym == Lexer::EQUAL) {
-                        lexer->next_token();
-                        operations.emplace_back(Node::LESS_EQUAL);
-                    } else if (lexer->sym == Lexer::ID || lexer->sym == Lexer::FUNCTION_ID
-                             || lexer->sym == Lexer::NUM_I || lexer->sym == Lexer::NUM_F || lexer->sym == Lexer::STR) {
-                        operations.emplace_back(Node::LESS);
-                    } else {
-                        error("expected '=' or operand");
-                    }
-                    continue;
-                }
-
-                break;
-            }
+        operands.push_back({primary(), nullptr});
 
-            std::vector<std::shared_ptr<Node>> tests;
-            for (std::vector<std::shared_ptr<Node>>::size_type i = 0; i != operands.size()-1; i++) {
-                tests.emplace_back(std::make_shared<Node>(operations.at(i), operands.at(i), operands.at(i+1)));
+        while (open != 0 && lexer->sym == Lexer::R_PARENT) {
+            while (operators.back().precedence != NONE) {
+                reduce();
             }
+            operators.pop_back();
+            operands.back().compared = nullptr; // '(a < b) < c' is no chain
+            open--;
 
-            x = nullptr;
-            for (auto &&test : tests) {
-                if (x != nullptr) {
-                    t = x;
-                    x = std::make_shared<Node>(Node::AND, t, test);
-                } else x = test;
-            }
+            lexer->next_token();
+        }
 
+        if (lexer->sym < 0 || lexer->sym > Lexer::EOI) {
             break;
         }
-        case Lexer::MORE: {
-            lexer->next_token();
-
-            std::vector<std::shared_ptr<Node>> operands = { x };
-            std::vector<unsigned> operations;
-
-            if (lexer->sym == Lexer::EQUAL) {
-                lexer->next_token();
-                operations.emplace_back(Node::MORE_EQUAL);
-            } else if (lexer->sym == Lexer::ID || lexer->sym == Lexer::FUNCTION_ID
-                       || lexer->sym == Lexer::NUM_I || lexer->sym == Lexer::NUM_F || lexer->sym == Lexer::STR) {
-                operations.emplace_back(Node::MORE);
-            } else {
-                error("expected '=' or operand");
-            }
-
-            while (true) {
-                operands.emplace_back(sum());
-
-                if (lexer->sym == Lexer::MORE) {
-                    lexer->next_token();
-
-                    if (lexer->sym == Lexer::EQUAL) {
-                        lexer->next_token();
-                        operations.emplace_back(Node::MORE_EQUAL);
-                    } else if (lexer->sym == Lexer::ID || lexer->sym == Lexer::FUNCTION_ID
-                               || lexer->sym == Lexer::NUM_I || lexer->sym == Lexer::NUM_F || lexer->sym == Lexer::STR) {
-                        operations.emplace_back(Node::MORE);
-                    } else {
-                        error("expected '=' or operand");
-                    }
-
-                    operations.emplace_back(Node::MORE);
-                    continue;
-                }
-
-                break;
-            }
-
-            std::vector<std::shared_ptr<Node>> tests;
-            for (std::vector<std::shared_ptr<Node>>::size_type i = 0; i != operands.size()-1; i++) {
-                tests.emplace_back(std::make_shared<Node>(operations.at(i), operands.at(i), operands.at(i+1)));
-            }
-
-            x = nullptr;
-            for (auto &&test : tests) {
-                if (x != nullptr) {
-                    t = x;
-                    x = std::make_shared<Node>(Node::AND, t, test);
-                } else x = test;
-            }
 
+        const Binary &binary = binary_operators[lexer->sym];
+        if (binary.precedence == NONE || (open == 0 && binary.precedence < lowest)) {
             break;
         }
-        case Lexer::IS: {
-            t = x;
-            x = std::make_shared<Node>(Node::EQUAL);
-            x->location = lexer->location;
 
+        Pending op{binary.kind, binary.precedence, binary.right, binary.typed, lexer->location};
+        lexer->next_token();
+
+        if (lexer->sym == binary.second) {
+            op.kind = binary.second_kind;
             lexer->next_token();
+        }
 
-            if (lexer->sym == Lexer::NOT) {
-                x = std::make_shared<Node>(Node::NOT_EQUAL);
-                x->location = lexer->location;
-                lexer->next_token();
-            }
+        while (operators.size() > operator_base && binds_before(operators.back(), op)) {
+            reduce();
+        }
+        operators.push_back(op);
+    }
 
-            x->o1 = t;
-            x->o2 = sum();
+    if (open != 0) {
+        error("expected ')'");
+    }
 
-            break;
-        }
+    while (operators.size() > operator_base) {
+        reduce();
     }
 
+    Node *x = operands.back().node;
+    operands.pop_back();
+
     return x;
 }
 
-std::shared_ptr<Node> Parser::expr() {
-    std::shared_ptr<Node> t, x;
+bool Parser::binds_before(const Pending &top, const Pending &op) {
+    return top.precedence > op.precedence || (top.precedence == op.precedence && !op.right);
+}
 
-    bool _not = false;
-    if (lexer->sym == Lexer::NOT) {
-        _not = true;
-        lexer->next_token();
-    }
+// applies the innermost pending operator to the operands on top of the stack
+void Parser::reduce() {
+    Pending op = operators.back();
+    operators.pop_back();
 
-    if (lexer->sym != Lexer::ID) {
-        if (_not) {
-            auto n = std::make_shared<Node>(Node::NOT);
-            x->location = lexer->location;
-            n->o1 = test();
-            return n;
-        } else {
-            return test();
-        }
+    if (op.precedence == SIGN) {
+        operands.back() = {negate(operands.back().node, op.location), nullptr};
+        return;
     }
 
-    x = test();
-    if (_not) {
-        t = x;
-        x = std::make_shared<Node>(Node::NOT);
-        x->location = lexer->location;
-        x->o1 = t;
+    Node *x = arena->make<Node>(op.kind);
+    x->location = op.location;
+
+    if (op.kind == Node::NOT) {
+        x->o1 = operands.back().node;
+        operands.back() = {x, nullptr};
+        return;
     }
 
-    if (lexer->sym == Lexer::AND) {
-        lexer->next_token();
-        t = x;
-        x = std::make_shared<Node>(Node::AND);
-        x->location = lexer->location;
-        x->o1 = t;
-        x->o2 = expr();
+    Operand right = operands.back();
+    operands.pop_back();
+    Operand &left = operands.back();
+
+    if (op.kind == Node::SET) {
+        assignment(x, left.node);
+        x->o1 = right.node;
+        left = {x, nullptr};
+    } else if (op.precedence == COMPARISON) {
+        // a chain 'a < b <= c' tests 'a < b and b <= c'
+        x->o1 = left.compared != nullptr ? left.compared : left.node;
+        x->o2 = right.node;
+
+        if (left.compared != nullptr) {
+            x = arena->make<Node>(Node::AND, left.node, x);
+            x->location = op.location;
+        }
+        left = {x, right.node};
+    } else {
+        x->o1 = left.node;
+        x->o2 = right.node;
+        if (op.typed) {
+            x->value_type = right.node->value_type;
+        }
+        left = {x, nullptr};
     }
+}
 
-    if (lexer->sym == Lexer::OR) {
-        lexer->next_token();
-        t = x;
-        x = std::make_shared<Node>(Node::OR);
-        x->location = lexer->location;
-        x->o1 = t;
-        x->o2 = expr();
+// '-operand' as '0 - operand'; a literal is negated in place instead, so
+// that -2147483648 is a constant, which fits in 32 bits
+Node *Parser::negate(Node *operand, Location location) {
+    if (operand->kind == Node::CONST && operand->value_type == Node::INTEGER) {
+        operand->int_val = -operand->int_val;
+        operand->location = location;
+        return operand;
+    }
+    if (operand->kind == Node::CONST && operand->value_type == Node::FLOATING) {
+        operand->float_val = -operand->float_val;
+        operand->location = location;
+        return operand;
     }
 
-    if (x->kind == Node::VAR_ACCESS || x->kind == Node::ARRAY_ACCESS || x->kind == Node::PROPERTY_ACCESS) {
-        if (lexer->sym == Lexer::EQUAL) {
-            t = x;
-            x = std::make_shared<Node>(Node::SET);
-            x->location = lexer->location;
+    Node *zero = arena->make<Node>(Node::CONST);
+    zero->location = location;
+    if (operand->value_type == Node::FLOATING) {
+        zero->value_type = Node::FLOATING;
+        zero->float_val = 0.0;
+    } else {
+        zero->value_type = Node::INTEGER;
+        zero->int_val = 0;
+    }
 
-            lexer->next_token();
+    Node *x = arena->make<Node>(Node::SUB, zero, operand);
+    x->location = location;
+    x->value_type = operand->value_type;
+    return x;
+}
 
-            x->var_name = t->var_name;
+// fills the SET node 'x' that stores into 'target'
+void Parser::assignment(Node *x, Node *target) {
+    if (target->kind != Node::VAR_ACCESS && target->kind != Node::ARRAY_ACCESS && target->kind != Node::PROPERTY_ACCESS) {
+        error("expected variable before '='");
+    }
 
-            if (t->kind == Node::ARRAY_ACCESS) {
-                x->o2 = t->o1;
+    x->var_name = target->var_name;
 
-            } else if (t->kind == Node::PROPERTY_ACCESS) {
-                x->property_name = t->property_name;
+    if (target->kind == Node::ARRAY_ACCESS) {
+        x->o2 = target->o1;
 
-                try {
-                    lexer->types.at(lexer->vars.at(x->var_name)->user_type_name)->properties.at(x->property_name);
-                } catch (std::out_of_range) {
-                    error(
-                            "object '" +
-                                    x->var_name +
-                                    "' of class '" +
-                                    lexer->vars.at(x->var_name)->user_type_name +
-                                    "' has no member named '" +
-                                    x->property_name + "'"
-                    );
-                }
-            }
+    } else if (target->kind == Node::PROPERTY_ACCESS) {
+        x->property_name = target->property_name;
 
-            x->o1 = expr();
-            x->value_type = t->value_type;
-            x->user_type = t->user_type;
+        Symbol class_name = lexer->var(x->var_name)->user_type_name;
+        const types::Member *member = lexer->type(class_name)->find(x->property_name);
+        if (member == nullptr || member->kind != types::Member::PROPERTY) {
+            error(
+                    "object '" +
+                            x->var_name.str() +
+                            "' of class '" +
+                            class_name.str() +
+                            "' has no member named '" +
+                            x->property_name.str() + "'"
+            );
         }
     }
 
-    return x;
+    x->value_type = target->value_type;
+    x->user_type = target->user_type;
 }
 
-std::shared_ptr<Node> Parser::var_def(bool isClassProperty) {
+Node *Parser::var_def(bool isClassProperty) {
     if (!isClassProperty) {
         lexer->next_token(true);
     }
 
-    std::shared_ptr<Node> x = std::make_shared<Node>(Node::VAR_DEF);
+    Node *x = arena->make<Node>(Node::VAR_DEF);
     x->location = lexer->location;
 
-    std::string var_name = lexer->str_val;
+    Symbol var_name = lexer->name;
     x->var_name = var_name;
-    last_vars.emplace_back(var_name);
 
     lexer->next_token();
     if (lexer->sym != Lexer::TYPE) {
@@ -593,7 +505,7 @@ std::shared_ptr<Node> Parser::var_def(bool isClassProperty) {
             break;
         case Lexer::USER_TYPE:
             x->value_type = Node::USER;
-            x->user_type = lexer->str_val;
+            x->user_type = lexer->name;
             break;
     }
 
@@ -603,10 +515,10 @@ std::shared_ptr<Node> Parser::var_def(bool isClassProperty) {
             lexer->next_token();
             if (lexer->sym == Lexer::ARRAY) {
                 if (lexer->arr_defined(var_name))
-                    error("'" + var_name + "' is already defined");
+                    error("'" + var_name.str() + "' is already defined");
 
                 lexer->next_token();
-                std::shared_ptr<Node> arr(new Node(Node::ARRAY));
+                Node *arr = arena->make<Node>(Node::ARRAY);
 
                 if (lexer->sym != Lexer::OF) {
                     error("expected array size");
@@ -619,13 +531,13 @@ std::shared_ptr<Node> Parser::var_def(bool isClassProperty) {
 
                 x->o1 = arr;
 
-                lexer->arrays.emplace(var_name, std::make_shared<types::Type>(x->value_type, x->user_type));
+                lexer->declare_array(var_name, std::make_shared<types::Type>(x->value_type, x->user_type));
             } else {
                 x->kind = Node::INIT;
                 x->o1 = expr();
             }
         }
-        lexer->vars.emplace(var_name, std::make_shared<types::Type>(x->value_type, x->user_type));
+        lexer->declare_var(var_name, std::make_shared<types::Type>(x->value_type, x->user_type));
     }
 
     if (lexer->sym != Lexer::SEMICOLON) {
@@ -637,24 +549,23 @@ std::shared_ptr<Node> Parser::var_def(bool isClassProperty) {
     return x;
 }
 
-std::shared_ptr<Node> Parser::function_arg() {
-    std::shared_ptr<Node> n;
+Node *Parser::function_arg() {
+    Node *n = nullptr;
 
     lexer->next_token(true);
 
     if (lexer->sym == Lexer::R_PARENT) {
-        return std::make_shared<Node>(Node::EMPTY);
+        return arena->make<Node>(Node::EMPTY);
     }
 
-    std::string var_name = lexer->str_val;
+    Symbol var_name = lexer->name;
 
-    n = std::make_shared<Node>(Node::ARG);
+    n = arena->make<Node>(Node::ARG);
     n->location = lexer->location;
     n->var_name = var_name;
 
     lexer->next_token();
     if (lexer->sym != Lexer::TYPE) {
-        std::cout << lexer->sym << std::endl;
         error("expected argument type");
     }
 
@@ -662,7 +573,6 @@ std::shared_ptr<Node> Parser::function_arg() {
     if (lexer->sym != Lexer::INT && lexer->sym != Lexer::FLOAT
         && lexer->sym != Lexer::STRING && lexer->sym != Lexer::BOOL
         && lexer->sym != Lexer::USER_TYPE) {
-        std::cout << lexer->sym << std::endl;
         error("expected argument type");
     }
 
@@ -681,52 +591,34 @@ std::shared_ptr<Node> Parser::function_arg() {
             break;
         case Lexer::USER_TYPE:
             n->value_type = Node::USER;
-            n->user_type = lexer->str_val;
+            n->user_type = lexer->name;
             break;
     }
 
-    lexer->vars[var_name] = std::make_shared<types::Type>(types::Type(n->value_type, n->user_type));
+    lexer->declare_var(var_name, std::make_shared<types::Type>(n->value_type, n->user_type));
     lexer->next_token();
 
     return n;
 }
 
-std::shared_ptr<Node> Parser::paren_expr() {
-    if (lexer->sym != Lexer::L_PARENT) {
-        std::cerr << lexer->sym << std::endl;
-        error("expected '('");
-    }
-
-    lexer->next_token();
-    std::shared_ptr<Node> n = expr();
-
-    if (lexer->sym != Lexer::R_PARENT) {
-        error("expected ')'");
-    }
-
-    lexer->next_token();
-    return n;
-}
-
-std::shared_ptr<Node> Parser::function_args() {
-    std::shared_ptr<Node> n(new Node(Node::ARG_LIST));
+Node *Parser::function_args() {
+    Node *n = arena->make<Node>(Node::ARG_LIST);
+    n->func_def_args = arena->make<ArgTypes>();
 
     if (lexer->sym != Lexer::L_PARENT) {
-        std::cerr << lexer->sym << std::endl;
         error("expected '(' in arguments list");
     }
 
     while (lexer->sym != Lexer::R_PARENT) {
-        std::shared_ptr<Node> arg = function_arg();
+        Node *arg = function_arg();
         if (arg->kind == Node::EMPTY) {
             break;
         }
 
-        n->func_def_args.emplace(arg->var_name, std::make_shared<types::Type>(arg->value_type, arg->user_type));
+        n->func_def_args->emplace(arg->var_name, std::make_shared<types::Type>(arg->value_type, arg->user_type));
     }
 
     if (lexer->sym != Lexer::R_PARENT) {
-        std::cerr << lexer->sym << std::endl;
         error("expected ')' in arguments list");
     }
 
@@ -734,18 +626,21 @@ std::shared_ptr<Node> Parser::function_args() {
     return n;
 }
 
-std::shared_ptr<Node> Parser::function_def() {
+// 'function name(args) : type' up to the body, the arguments declared in a
+// scope left open for it; 'check' that no function has that name yet
+Node *Parser::function_head(bool check) {
     lexer->next_token(true); // eat 'function' keyword
-    std::string func_name = lexer->str_val;
+    Symbol func_name = lexer->name;
 
-    if (lexer->fn_defined(func_name))
-        error("function '" + func_name + "' is already defined");
+    if (check && lexer->fn_defined(func_name))
+        error("function '" + func_name.str() + "' is already defined");
 
-    std::shared_ptr<Node> x = std::make_shared<Node>(Node::FUNCTION_DEFINE);
+    Node *x = arena->make<Node>(Node::FUNCTION_DEFINE);
     x->location = lexer->location;
     x->var_name = func_name;
 
     lexer->next_token();
+    lexer->enter_scope(); // arguments and locals
     x->o1 = function_args();
 
     if (lexer->sym != Lexer::TYPE) {
@@ -774,144 +669,101 @@ std::shared_ptr<Node> Parser::function_def() {
                 break;
             case Lexer::USER_TYPE:
                 x->value_type = Node::USER;
-                x->user_type = lexer->str_val;
+                x->user_type = lexer->name;
                 break;
         }
         lexer->next_token();
     }
-    lexer->functions.emplace(func_name, std::make_shared<types::Type>(x->value_type, x->user_type));
-
-    x->o2 = statement();
-
-    for (auto &&var : last_vars) {
-        lexer->vars.erase(var);
-        last_vars.erase(std::find(std::cbegin(last_vars), std::cend(last_vars), var));
-    }
 
     return x;
 }
 
-std::shared_ptr<Node> Parser::method_def(const std::string &class_name) {
-    lexer->next_token(true); // eat 'function' keyword
-    std::string func_name = lexer->str_val;
-
-    //if (lexer->fn_defined(func_name))
-    //    error("function '" + func_name + "' is already defined");
-
-    std::shared_ptr<Node> x = std::make_shared<Node>(Node::FUNCTION_DEFINE);
-    x->location = lexer->location;
-    x->var_name = func_name;
-
-    lexer->next_token();
-    x->o1 = function_args();
-
-    if (lexer->sym != Lexer::TYPE) {
-        x->value_type = Node::VOID;
-    } else {
+// the body of 'x', which closes the scope of its arguments; while declaring
+// ahead the body is only skipped, parse_body() fills it in later
+void Parser::function_body(Node *x, Symbol class_name, std::size_t head) {
+    if (bodies != nullptr) {
+        bodies->push_back({x, class_name, head, lexer->sym == Lexer::L_BRACKET ? lexer->skip_braces() : lexer->skip_member()});
         lexer->next_token();
+    } else {
+        x->o2 = statement();
+    }
+    lexer->leave_scope();
+}
 
-        if (lexer->sym != Lexer::INT && lexer->sym != Lexer::FLOAT
-            && lexer->sym != Lexer::STRING && lexer->sym != Lexer::BOOL
-            && lexer->sym != Lexer::USER_TYPE) {
-            error("expected type of return value");
-        }
+Node *Parser::function_def() {
+    std::size_t head = lexer->position();
+    Node *x = function_head(!redefining);
+    redefining = false; // functions in its body are checked
+    lexer->declare_function(x->var_name, std::make_shared<types::Type>(x->value_type, x->user_type));
 
-        switch (lexer->sym) {
-            case Lexer::INT:
-                x->value_type = Node::INTEGER;
-                break;
-            case Lexer::FLOAT:
-                x->value_type = Node::FLOATING;
-                break;
-            case Lexer::STRING:
-                x->value_type = Node::STRING;
-                break;
-            case Lexer::BOOL:
-                x->value_type = Node::BOOL;
-                break;
-            case Lexer::USER_TYPE:
-                x->value_type = Node::USER;
-                x->user_type = lexer->str_val;
-                break;
-        }
-        lexer->next_token();
-    }
-    x->o2 = statement();
+    function_body(x, Symbol(), head);
+    return x;
+}
 
-    for (auto &&var : last_vars) {
-        lexer->vars.erase(var);
-        last_vars.erase(std::find(std::cbegin(last_vars), std::cend(last_vars), var));
-    }
+Node *Parser::method_def(Symbol class_name) {
+    std::size_t head = lexer->position();
+    Node *x = function_head(false);
 
+    function_body(x, class_name, head);
     return x;
 }
 
-std::shared_ptr<Node> Parser::statement() {
-    std::shared_ptr<Node> t, x;
+Node *Parser::statement() {
+    Node *x = nullptr;
 
     switch (lexer->sym) {
         case Lexer::CLASS: {
-            x = std::make_shared<Node>(Node::CLASS_DEFINE);
+            x = arena->make<Node>(Node::CLASS_DEFINE);
             x->location = lexer->location;
+            x->class_def = arena->make<ClassBody>();
 
             lexer->next_token(true);
-            std::string class_name = lexer->str_val;
+            Symbol class_name = lexer->name;
 
-            if (lexer->type_defined(class_name))
-                error("type '" + class_name + "' is already defined");
+            std::shared_ptr<types::AbstractType> type;
+            if (bodies != nullptr) {
+                type = lexer->type(class_name); // declared ahead, as every class of the file
+            } else {
+                if (!redefining && lexer->type_defined(class_name))
+                    error("type '" + class_name.str() + "' is already defined");
+                redefining = false;
 
-            x->var_name = class_name;
-            lexer->vars.emplace("this", std::make_shared<types::Type>(Node::USER, class_name));
+                type = std::make_shared<types::AbstractType>();
+                lexer->declare_type(class_name, type);
+            }
 
-            std::unordered_map<std::string, std::shared_ptr<types::Member>> properties;
-            std::unordered_map<std::string, std::shared_ptr<types::Member>> methods;
-            lexer->types.emplace(class_name, std::make_shared<types::AbstractType>(properties, methods));
+            x->var_name = class_name;
+            lexer->enter_scope(); // 'this' and the properties
+            lexer->declare_var(names::self, std::make_shared<types::Type>(Node::USER, class_name));
 
             lexer->next_token();
             if (lexer->sym != Lexer::L_BRACKET) {
                 if (lexer->sym == Lexer::INHERIT) {
                     lexer->next_token();
-                    std::string base_class_name = lexer->str_val;
+                    Symbol base_class_name = lexer->name;
                     lexer->next_token();
 
                     if (lexer->sym != Lexer::L_BRACKET) {
                         error("expected '{'");
                     }
 
-                    //x = std::make_shared<Node>(Node::CLASS_INHERIT);
+                    //x = arena->make<Node>(Node::CLASS_INHERIT);
                     //x->kind = Node::CLASS_INHERIT;
                     //x->var_name = class_name;
                     //x->property_name = base_class_name;
 
-                    auto base_class = lexer->types.at(base_class_name);
-                    lexer->types.at(class_name) = base_class;
-                    properties = base_class->properties;
-                    methods = base_class->methods;
-                    methods.erase(base_class_name);
-
-                    for (auto &&property : properties) {
-                        x->class_def_properties.emplace(
-                            property.first,
-                            std::make_pair(
-                                base_class->properties.at(property.first)->access_type,
-                                base_class->properties.at(property.first)->ast_node
-                            )
-                        );
-                    }
-                    for (auto &&method : methods) {
-                        for (auto &&iter : method.second->ast_node->func_def_args) {
-                            if (iter.first == "this") {
-                                iter.second->user_type_name = class_name;
+                    // every member of the base but its constructor
+                    *type = *lexer->type(base_class_name);
+                    type->remove(base_class_name);
+
+                    for (auto &&member : type->members) {
+                        if (member->kind == types::Member::METHOD) {
+                            for (auto &&iter : *member->ast_node->o1->func_def_args) {
+                                if (iter.first == names::self) {
+                                    iter.second->user_type_name = class_name;
+                                }
                             }
                         }
-                        x->class_def_methods.emplace_hint(
-                            std::begin(x->class_def_methods),
-                            method.first,
-                            std::make_pair(
-                                base_class->methods.at(method.first)->access_type,
-                                base_class->methods.at(method.first)->ast_node
-                            )
-                        );
                     }
                 } else {
                     error("expected '{'");
@@ -944,41 +796,30 @@ std::shared_ptr<Node> Parser::statement() {
                 }
 
                 if (lexer->sym == Lexer::FUNCTION) {
-                    std::shared_ptr<Node> method_node = method_def(class_name);
-                    std::shared_ptr<types::Member> method = std::make_shared<types::Member>(
+                    Node *method_node = method_def(class_name);
+                    if (!override && type->find(method_node->var_name) != nullptr) {
+                        error("method '" + method_node->var_name.str() + "' of class '" + class_name.str() + "' is already defined, use 'override' keyword to override it");
+                    }
+
+                    type->define(std::make_shared<types::Member>(
+                        method_node->var_name,
+                        types::Member::METHOD,
                         std::make_shared<types::Type>(method_node->value_type, method_node->user_type),
                         method_node,
                         access_type
-                    );
-                    if (override) {
-                        x->class_def_methods.insert_or_assign(method_node->var_name,
-                                                              std::make_pair(access_type, method_node));
-                        methods.insert_or_assign(method_node->var_name, method);
-                    } else {
-                        bool method_defined =
-                            x->class_def_methods.find(method_node->var_name) != std::cend(x->class_def_methods)
-                                || methods.find(method_node->var_name) != std::cend(methods);
-
-                        if (method_defined) {
-                            error("method '" + method_node->var_name + "' of class '" + class_name + "' is already defined, use 'override' keyword to override it");
-                        }
-
-                        x->class_def_methods.emplace(method_node->var_name,
-                                                     std::make_pair(access_type, method_node));
-                        methods.emplace(method_node->var_name, method);
-                    }
-                    lexer->types.at(class_name)->methods = methods;
+                    ));
                 }
                 else if (lexer->sym == Lexer::ID) {
-                    std::shared_ptr<Node> property_node = var_def(true);
-                    std::shared_ptr<types::Member> property = std::make_shared<types::Member>(
-                        std::make_shared<types::Type>(property_node->value_type, property_node->user_type),
-                        property_node,
-                        access_type
-                    );
-                    x->class_def_properties.emplace(property_node->var_name, std::make_pair(access_type, property_node));
-                    properties.emplace(property_node->var_name, property);
-                    lexer->types.at(class_name)->properties = properties;
+                    Node *property_node = var_def(true);
+                    if (type->find(property_node->var_name) == nullptr) {
+                        type->define(std::make_shared<types::Member>(
+                            property_node->var_name,
+                            types::Member::PROPERTY,
+                            std::make_shared<types::Type>(property_node->value_type, property_node->user_type),
+                            property_node,
+                            access_type
+                        ));
+                    }
 
                     lexer->next_token();
                     if (lexer->sym != Lexer::SEMICOLON) {
@@ -993,84 +834,67 @@ std::shared_ptr<Node> Parser::statement() {
 
                     lexer->next_token();
                     break;
+                } else {
+                    error("Invalid statement syntax");
                 }
             }
 
-            // workaround to make calling of methods from other methods of this class possible
-            std::unordered_map<std::string, std::pair<int, std::shared_ptr<Node>>> temp1;
-            std::unordered_map<std::string, std::pair<int, std::shared_ptr<Node>>> temp2;
-            for (auto iterator = x->class_def_methods.begin(); iterator != x->class_def_methods.find(class_name); ++iterator) {
-                temp1.emplace(*iterator);
-            }
-            for (auto iterator = ++x->class_def_methods.find(class_name); iterator != x->class_def_methods.end(); ++iterator) {
-                temp2.emplace(*iterator);
-            }
-            std::unordered_map<std::string, std::pair<int, std::shared_ptr<Node>>> temp;
-            for (auto &&item : temp1) {
-                temp.emplace(item);
+            for (auto &&member : type->members) {
+                auto &list = member->kind == types::Member::METHOD ? x->class_def->methods : x->class_def->properties;
+                if (member->name != class_name) {
+                    list.push_back({member->name, member->access_type, member->ast_node});
+                }
             }
-            for (auto &&item : temp2) {
-                temp.emplace(item);
+            if (const types::Member *constructor = type->find(class_name)) {
+                x->class_def->methods.push_back({class_name, constructor->access_type, constructor->ast_node});
             }
-            temp.emplace(*x->class_def_methods.find(class_name));
-            x->class_def_methods.clear();
-            x->class_def_methods = temp;
 
-            lexer->vars.erase("this");
+            lexer->leave_scope();
             break;
         }
         case Lexer::IF: {
-            x = std::make_shared<Node>(Node::IF);
+            x = arena->make<Node>(Node::IF);
             x->location = lexer->location;
             lexer->next_token();
 
             x->o1 = expr(); //paren_expr();
 
-            std::vector<std::string> _temp(last_vars);
-            last_vars.clear();
-
+            lexer->enter_scope();
             x->o2 = statement();
-
-            for (auto &&var : last_vars) {
-                lexer->vars.erase(var);
-                last_vars.erase(std::find(std::cbegin(last_vars), std::cend(last_vars), var));
-            }
-            last_vars = _temp;
+            lexer->leave_scope();
 
             if (lexer->sym == Lexer::ELSE) {
                 x->kind = Node::ELSE;
                 lexer->next_token();
 
-                std::vector<std::string> __temp(last_vars);
-                last_vars.clear();
-
+                lexer->enter_scope();
                 x->o3 = statement();
-
-                for (auto &&var : last_vars) {
-                    lexer->vars.erase(var);
-                    last_vars.erase(std::find(std::cbegin(last_vars), std::cend(last_vars), var));
-                }
-                last_vars = __temp;
+                lexer->leave_scope();
             }
 
             break;
         }
         case Lexer::WHILE: {
-            x = std::make_shared<Node>(Node::WHILE);
+            x = arena->make<Node>(Node::WHILE);
             x->location = lexer->location;
             lexer->next_token();
 
             x->o1 = expr(); //paren_expr();
+
+            lexer->enter_scope();
             x->o2 = statement();
+            lexer->leave_scope();
 
             break;
         }
         case Lexer::DO: {
-            x = std::make_shared<Node>(Node::DO);
+            x = arena->make<Node>(Node::DO);
             x->location = lexer->location;
             lexer->next_token();
 
+            lexer->enter_scope();
             x->o1 = statement();
+            lexer->leave_scope();
 
             if (lexer->sym != Lexer::WHILE) {
                 error("expected 'while'");
@@ -1089,13 +913,16 @@ std::shared_ptr<Node> Parser::statement() {
             break;
         }
         case Lexer::REPEAT: {
-            x = std::make_shared<Node>(Node::REPEAT);
+            x = arena->make<Node>(Node::REPEAT);
             x->location = lexer->location;
             lexer->next_token();
 
             x->o1 = sum(); //paren_expr();
-            lexer->vars.try_emplace("index", std::make_shared<types::Type>(Node::INTEGER, ""));
+            lexer->declare_var(names::index, std::make_shared<types::Type>(Node::INTEGER, Symbol()));
+
+            lexer->enter_scope();
             x->o2 = statement();
+            lexer->leave_scope();
 
             break;
         }
@@ -1109,12 +936,11 @@ std::shared_ptr<Node> Parser::statement() {
         }
         case Lexer::DELETE: {
             lexer->next_token();
-            last_vars.erase(std::find(std::cbegin(last_vars), std::cend(last_vars), lexer->str_val));
-            lexer->vars.erase(lexer->str_val);
+            lexer->forget_var(lexer->name);
 
-            x = std::make_shared<Node>(Node::DELETE);
+            x = arena->make<Node>(Node::DELETE);
             x->location = lexer->location;
-            x->var_name = lexer->str_val;
+            x->var_name = lexer->name;
 
             lexer->next_token();
 
@@ -1123,9 +949,9 @@ std::shared_ptr<Node> Parser::statement() {
         case Lexer::INPUT: {
             lexer->next_token();
 
-            x = std::make_shared<Node>(Node::INPUT);
+            x = arena->make<Node>(Node::INPUT);
             x->location = lexer->location;
-            x->var_name = lexer->str_val;
+            x->var_name = lexer->name;
 
             lexer->next_token();
 
@@ -1140,7 +966,7 @@ std::shared_ptr<Node> Parser::statement() {
         case Lexer::PRINTLN: {
             lexer->next_token();
 
-            x = std::make_shared<Node>(Node::PRINTLN);
+            x = arena->make<Node>(Node::PRINTLN);
             x->location = lexer->location;
             x->o1 = sum();
 
@@ -1151,38 +977,31 @@ std::shared_ptr<Node> Parser::statement() {
         case Lexer::RETURN: {
             lexer->next_token();
 
-            x = std::make_shared<Node>(Node::RETURN);
+            x = arena->make<Node>(Node::RETURN);
             x->location = lexer->location;
             x->o1 = sum();
 
             break;
         }
         case Lexer::SEMICOLON: {
-            x = std::make_shared<Node>(Node::EMPTY);
+            x = arena->make<Node>(Node::EMPTY);
             x->location = lexer->location;
             lexer->next_token();
 
             break;
         }
         case Lexer::L_BRACKET: {
-            x = std::make_shared<Node>(Node::EMPTY);
+            x = arena->make<Node>(Node::BLOCK);
             x->location = lexer->location;
             lexer->next_token();
 
-            while (lexer->sym != Lexer::R_BRACKET) {
-                t = x;
-                x = std::make_shared<Node>(Node::SEQ);
-                x->location = lexer->location;
-
-                x->o1 = t;
-                x->o2 = statement();
-            }
+            x->statements = block(Lexer::R_BRACKET);
             lexer->next_token();
 
             break;
         }
         default: {
-            x = std::make_shared<Node>(Node::EXPR);
+            x = arena->make<Node>(Node::EXPR);
             x->location = lexer->location;
             x->o1 = expr();
 
@@ -1197,25 +1016,347 @@ std::shared_ptr<Node> Parser::statement() {
     return x;
 }
 
-std::shared_ptr<Node> Parser::parse() {
-    std::shared_ptr<Node> t, x;
-
-    x = std::make_shared<Node>(Node::EMPTY);
+Node *Parser::parse() {
+    Node *x = arena->make<Node>(Node::BLOCK);
     x->location = lexer->location;
+
+    if (!lexer->tokenized() && !lexer->streamed()) {
+        lexer->tokenize(threads); // declaring ahead needs every token
+    }
+
+    declare_all();
+    if (ahead) {
+        std::vector<Node *> statements;
+        lexer->seek(0);
+        lexer->next_token();
+        while (lexer->sym != Lexer::EOI) {
+            statements.push_back(top_level());
+        }
+        finish();
+
+        x->statements = {arena->copy(statements.data(), statements.size()), static_cast<std::uint32_t>(statements.size())};
+        return x;
+    }
+
     lexer->next_token();
 
-    while (lexer->sym != Lexer::EOI) {
-        t = x;
-        x = std::make_shared<Node>(Node::SEQ);
-        x->location = lexer->location;
+    x->statements = block(Lexer::EOI);
 
-        x->o1 = t;
-        x->o2 = statement();
+    if (lexer->sym != Lexer::EOI) {
+        error("Invalid statement syntax");
+    }
+
+    return x;
+}
+
+// Finds the top-level functions and classes by their brackets alone; a
+// function whose body is a single statement gets 'last' 0, its end is only
+// known once it is parsed. False when the brackets do not match: the file is
+// then parsed in one pass, which reports where.
+bool Parser::find_declarations(std::vector<Item> &items) const {
+    std::size_t n = lexer->token_count() - 1; // the last token is EOI
+    auto kind = [&](std::size_t i) { return i < n ? lexer->token_kind(i) : static_cast<int>(Lexer::EOI); };
+    auto closing = [&](std::size_t i, int open, int close) { // the bracket closing the one at 'i', n when there is none
+        unsigned depth = 0;
+        for (; i < n; i++) {
+            if (kind(i) == open) {
+                depth++;
+            } else if (kind(i) == close && --depth == 0) {
+                break;
+            }
+        }
+        return i;
+    };
+
+    int depth = 0;
+    for (std::size_t i = 0; i < n; i++) {
+        switch (kind(i)) {
+            case Lexer::L_BRACKET:
+                depth++;
+                break;
+            case Lexer::R_BRACKET:
+                if (--depth < 0) {
+                    return false;
+                }
+                break;
+            case Lexer::FUNCTION: {
+                if (depth != 0) {
+                    break;
+                }
+
+                std::size_t j = i + 2; // past the name
+                if (kind(j) != Lexer::L_PARENT) {
+                    return false;
+                }
+                j = closing(j, Lexer::L_PARENT, Lexer::R_PARENT) + 1;
+                if (kind(j) == Lexer::TYPE) {
+                    j += 2;
+                }
+                if (kind(j) != Lexer::L_BRACKET) {
+                    items.push_back({i, 0, nullptr});
+                    i = j - 1; // the statement is scanned like the code around it
+                    break;
+                }
+                if ((j = closing(j, Lexer::L_BRACKET, Lexer::R_BRACKET)) == n) {
+                    return false;
+                }
+
+                items.push_back({i, j + 1, nullptr});
+                i = j;
+                break;
+            }
+            case Lexer::CLASS: {
+                if (depth != 0) {
+                    break;
+                }
+
+                std::size_t j = kind(i + 2) == Lexer::INHERIT ? i + 4 : i + 2;
+                if (kind(j) != Lexer::L_BRACKET || (j = closing(j, Lexer::L_BRACKET, Lexer::R_BRACKET)) == n
+                    || kind(j + 1) != Lexer::SEMICOLON) {
+                    return false;
+                }
+
+                items.push_back({i, j + 2, nullptr});
+                i = j + 1;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    return depth == 0;
+}
+
+// Declares the names of 'items': classes, then the members of each class and
+// the signatures of the functions. The bodies are skipped and returned in
+// source order; a function whose body is a single statement, of unknown
+// end, is left to top_level() to parse where it stands.
+std::vector<Parser::Body> Parser::declare(std::vector<Item> &items) {
+    std::unordered_map<Symbol, std::size_t> classes;
+    for (std::size_t k = 0; k != items.size(); k++) {
+        if (lexer->token_kind(items[k].first) == Lexer::CLASS) {
+            lexer->seek(items[k].first + 1, items[k].first + 2);
+            lexer->next_token(true);
+
+            if (lexer->type_defined(lexer->name))
+                error("type '" + lexer->name.str() + "' is already defined");
+
+            lexer->declare_type(lexer->name, std::make_shared<types::AbstractType>());
+            classes.emplace(lexer->name, k);
+        }
+    }
+
+    // a base class is declared before the classes derived from it, wherever it is
+    std::vector<Body> list;
+    std::vector<unsigned char> state(items.size()); // 1 while being declared, 2 after
+    auto declare = [&](std::size_t k, auto &self) -> void {
+        if (state[k] != 0) {
+            return;
+        }
+        state[k] = 1;
+
+        Item &item = items[k];
+        if (lexer->token_kind(item.first) == Lexer::CLASS && lexer->token_kind(item.first + 2) == Lexer::INHERIT) {
+            lexer->seek(item.first + 3, item.first + 4);
+            lexer->next_token(true);
+
+            auto base = classes.find(lexer->name);
+            if (base != std::end(classes)) {
+                self(base->second, self);
+            }
+        }
+
+        lexer->seek(item.first, item.last != 0 ? item.last : SIZE_MAX);
+        lexer->next_token();
+        if (item.last != 0) {
+            item.node = statement();
+        } else {
+            Node *x = function_head(true);
+            lexer->declare_function(x->var_name, std::make_shared<types::Type>(x->value_type, x->user_type));
+            lexer->leave_scope();
+        }
+        state[k] = 2;
+    };
+
+    bodies = &list;
+    for (std::size_t k = 0; k != items.size(); k++) {
+        declare(k, declare);
+    }
+    bodies = nullptr;
+
+    std::sort(std::begin(list), std::end(list), [](const Body &a, const Body &b) { return a.head < b.head; });
+    return list;
+}
+
+// Each thread has a lexer of its own over the shared tokens and an arena
+// the tree's arena takes over at the end. The error reported is the one
+// a single thread would have met first.
+void Parser::parse_bodies(std::vector<Body> &list) {
+    auto count = static_cast<unsigned>(std::min<std::size_t>(threads, list.size()));
+    if (count <= 1) { // on a lexer of its own all the same, the globals a body sees are no business of this one
+        Lexer l;
+        l.attach(*lexer);
+        Parser p(&l, arena);
+        p.global_names = global_names;
+
+        for (auto &&body : list) {
+            p.parse_body(body);
+        }
+        return;
+    }
+
+    std::atomic<std::size_t> next{0};
+    std::vector<std::exception_ptr> failed(list.size());
+    std::vector<std::unique_ptr<Arena>> arenas;
+    std::vector<std::thread> workers;
+
+    for (unsigned w = 0; w != count; w++) {
+        arenas.push_back(std::make_unique<Arena>());
+        workers.emplace_back([this, &list, &next, &failed, a = arenas.back().get()] {
+            Lexer l;
+            l.attach(*lexer);
+            Parser p(&l, a);
+            p.global_names = global_names;
+
+            for (std::size_t i; (i = next++) < list.size();) {
+                try {
+                    p.parse_body(list[i]);
+                } catch (...) {
+                    failed[i] = std::current_exception();
+                    next = list.size(); // bodies after this one do not matter, those before are all taken
+                    break;
+                }
+            }
+        });
+    }
+    for (auto &&worker : workers) {
+        worker.join();
+    }
+
+    for (auto &&a : arenas) {
+        arena->adopt(*a);
+    }
+    for (auto &&error : failed) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+// as method_def() or function_def() would have where its class or function is
+// defined: with the classes and functions of the file, and the top-level
+// variables declared above it
+void Parser::parse_body(const Body &body) {
+    if (body.globals.get() != seen) {
+        for (Symbol name : global_names) {
+            auto binding = lexer->symbols.find(name);
+            if (binding != std::end(lexer->symbols)) {
+                binding->second.var = nullptr;
+                binding->second.array = nullptr;
+                if (binding->second.empty()) {
+                    lexer->symbols.erase(binding);
+                }
+            }
+        }
+        for (auto &&global : *body.globals) {
+            auto &binding = lexer->symbols[global.name];
+            binding.var = global.var;
+            binding.array = global.array;
+        }
+        seen = body.globals.get();
+    }
+
+    lexer->seek(body.head, body.end);
+    lexer->next_token();
+
+    if (!body.class_name.empty()) {
+        lexer->enter_scope();
+        lexer->declare_var(names::self, std::make_shared<types::Type>(Node::USER, body.class_name));
     }
 
+    function_head(false); // declares the arguments again, its nodes are not used
+    body.function->o2 = statement();
     if (lexer->sym != Lexer::EOI) {
         error("Invalid statement syntax");
     }
+    lexer->leave_scope();
 
+    if (!body.class_name.empty()) {
+        lexer->leave_scope();
+    }
+}
+
+void Parser::declare_all() {
+    std::vector<Item> items;
+    if (lexer->tokenized() && find_declarations(items)) {
+        declared_bodies = declare(items);
+        declared = std::move(items);
+        next_declared = 0;
+        next_body = 0;
+        global_names.clear();
+        globals = nullptr;
+        ahead = true;
+    }
+}
+
+// A class or function declared ahead is taken as it is, its tokens skipped,
+// and its bodies get the top-level variables bound here; a function whose
+// body is a single statement is parsed here, as it would be in one pass.
+Node *Parser::top_level() {
+    if (next_declared != declared.size() && lexer->position() >= declared[next_declared].first) {
+        if (lexer->position() != declared[next_declared].first) {
+            error("Invalid statement syntax");
+        }
+
+        const Item &item = declared[next_declared++];
+        if (item.last == 0) {
+            redefining = true;
+            return statement();
+        }
+
+        if (!globals) {
+            auto bound = std::make_shared<std::vector<Global>>();
+            for (Symbol name : global_names) {
+                auto binding = lexer->symbols.find(name);
+                if (binding != std::end(lexer->symbols) && (binding->second.var || binding->second.array)) {
+                    bound->push_back({name, binding->second.var, binding->second.array});
+                }
+            }
+            globals = std::move(bound);
+        }
+        for (; next_body != declared_bodies.size() && declared_bodies[next_body].head < item.last; next_body++) {
+            declared_bodies[next_body].globals = globals;
+        }
+
+        lexer->seek(item.last);
+        lexer->next_token();
+        return item.node;
+    }
+
+    redefining = ahead && (lexer->sym == Lexer::FUNCTION || lexer->sym == Lexer::CLASS);
+    Node *x = statement();
+
+    // the variables a top-level statement leaves bound
+    if (x->kind == Node::VAR_DEF || x->kind == Node::INIT) {
+        global_names.insert(x->var_name);
+    } else if (x->kind == Node::REPEAT) {
+        global_names.insert(names::index);
+    }
+    globals = nullptr;
     return x;
 }
+
+void Parser::finish() {
+    if (next_declared != declared.size()) {
+        error("Invalid statement syntax");
+    }
+
+    parse_bodies(declared_bodies);
+    declared.clear();
+    declared_bodies.clear();
+    next_declared = 0;
+    next_body = 0;
+    global_names.clear();
+    globals = nullptr;
+}
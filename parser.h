@@ -5,33 +5,132 @@
 #ifndef TURNIP2_PARSER_H
 #define TURNIP2_PARSER_H
 
+#include "arena.h"
 #include "lexer.h"
 #include "utilities.h"
 
+#include <memory>
+#include <unordered_set>
 #include <vector>
 
 using namespace turnip2;
 
 class Parser {
+public:
+    // binding power of the operators, loosest first
+    enum Precedence : unsigned char {
+        NONE, ASSIGNMENT, DISJUNCTION, CONJUNCTION, NEGATION, COMPARISON, ADDITIVE, MULTIPLICATIVE, SIGN
+    };
+
+private:
     Lexer *lexer;
-    std::vector<std::string> last_vars;
+    Arena *arena;
+    unsigned threads;
+
+    // a top-level function or class, tokens [first, last)
+    struct Item {
+        std::size_t first;
+        std::size_t last;
+        Node *node;
+    };
+
+    // a top-level variable or array as it is bound where a class or function is defined
+    struct Global {
+        Symbol name;
+        std::shared_ptr<types::Type> var;
+        std::shared_ptr<types::Type> array;
+    };
+
+    // A function or method body left for after every declaration of the
+    // file, parsed on any thread into 'function'. It sees the top-level
+    // variables declared above its class or function, as a single pass would.
+    struct Body {
+        Node *function;
+        Symbol class_name; // empty for a function
+        std::size_t head; // token of its 'function' keyword
+        std::size_t end; // one past its last token
+        std::shared_ptr<const std::vector<Global>> globals;
+    };
+
+    std::vector<Body> *bodies = nullptr; // while declaring ahead: bodies in braces are skipped and listed here
+    bool ahead = false; // declare_all() was called
+    bool redefining = false; // top_level() parses a class or function of the file again, it is no duplicate
+
+    // what declare_all() declared, in source order, with the next of them
+    // for top_level() and the bodies left for finish()
+    std::vector<Item> declared;
+    std::size_t next_declared = 0;
+    std::vector<Body> declared_bodies;
+    std::size_t next_body = 0; // the first of them whose globals are not known yet
+
+    // names the top-level statements bound as variables, and how they are
+    // bound after the last of those statements (null until it is asked for)
+    std::unordered_set<Symbol> global_names;
+    std::shared_ptr<const std::vector<Global>> globals;
+    const std::vector<Global> *seen = nullptr; // the globals parse_body() bound last
+
+    // an operator waiting for its right operand, or an open '(' (precedence NONE)
+    struct Pending {
+        unsigned short kind;
+        unsigned char precedence;
+        bool right;
+        bool typed;
+        Location location;
+    };
+
+    struct Operand {
+        Node *node;
+        Node *compared; // right operand of the comparison chain 'node' ends with, if it is one
+    };
+
+    std::vector<Pending> operators;
+    std::vector<Operand> operands;
 
     void error(const std::string &e);
-    std::shared_ptr<Node> term();
-    std::shared_ptr<Node> sum();
-    std::shared_ptr<Node> test();
-    std::shared_ptr<Node> expr();
-    std::shared_ptr<Node> paren_expr();
-    std::shared_ptr<Node> var_def(bool isClassProperty = false);
-    std::shared_ptr<Node> function_arg();
-    std::shared_ptr<Node> function_args();
-    std::shared_ptr<Node> function_def();
-    std::shared_ptr<Node> method_def(const std::string &class_name);
-    std::shared_ptr<Node> statement();
+    NodeList call_args();
+    void method_call(Node *x, const types::Member *member);
+    NodeList block(int end);
+    Node *primary();
+    Node *expression(Precedence lowest);
+    static bool binds_before(const Pending &top, const Pending &op);
+    void reduce();
+    Node *negate(Node *operand, Location location);
+    void assignment(Node *x, Node *target);
+    Node *sum(); // arithmetic only, stops at comparisons, 'and', 'or' and '='
+    Node *expr();
+    Node *var_def(bool isClassProperty = false);
+    Node *function_arg();
+    Node *function_args();
+    Node *function_head(bool check);
+    void function_body(Node *x, Symbol class_name, std::size_t head);
+    Node *function_def();
+    Node *method_def(Symbol class_name);
+    Node *statement();
+    bool find_declarations(std::vector<Item> &items) const;
+    std::vector<Body> declare(std::vector<Item> &items);
+    void parse_bodies(std::vector<Body> &list);
+    void parse_body(const Body &body);
 
 public:
-    explicit Parser(Lexer *l) : lexer(l) {}
-    std::shared_ptr<Node> parse();
+    Parser(Lexer *l, Arena *a, unsigned parser_threads = 1) : lexer(l), arena(a), threads(parser_threads) {}
+
+    // The tree lives as long as the arena. Loaded input is tokenized, if it
+    // is not yet, and parsed in two phases: every class, method and function
+    // signature is declared first, so they may be used above their
+    // definition, then the bodies are parsed on up to 'threads' threads. A
+    // stream is parsed in one pass as it is read, in bounded memory: there
+    // a class or function has to be defined above its first use.
+    Node *parse();
+
+    // Parsing a tokenized input piecewise, as parse() does it: declare_all()
+    // declares every class, method and function signature up front, then
+    // top_level() parses the statement at the lexer's position alone, and
+    // finish() parses the bodies of the functions and methods declared, each
+    // with the top-level variables declared above it. A statement parsed
+    // again later may define a class or function declared ahead once more.
+    void declare_all();
+    Node *top_level();
+    void finish();
 
 };
 
@@ -0,0 +1,364 @@
+//
+// Created by NEzyaka on 17.10.26.
+//
+
+#include "resolver.h"
+
+namespace {
+    // what the slot of a variable of that type holds: the value itself, or
+    // for an argument a pointer to the caller's string or object
+    unsigned char storage_of(int value_type, bool argument) {
+        switch (value_type) {
+            case Node::STRING:
+                return argument ? Node::STRING_POINTER : Node::STRING_BUFFER;
+            case Node::USER:
+                return argument ? Node::OBJECT_POINTER : Node::OBJECT;
+            default:
+                return Node::SCALAR;
+        }
+    }
+
+    std::string type_name(const Node *n) {
+        return n->value_type == Node::USER ? n->user_type.str() : (n->value_type == Node::INTEGER ? "int" : "float");
+    }
+}
+
+void Resolver::error(unsigned line, const std::string &e) {
+    throw std::string(std::to_string(line) + " -> " + e);
+}
+
+void Resolver::declare_ahead(const Node *root) {
+    if (root->kind != Node::BLOCK) {
+        return;
+    }
+
+    for (const Node *statement : root->statements) {
+        if (statement->kind == Node::FUNCTION_DEFINE) {
+            functions[statement->var_name] = statement;
+        } else if (statement->kind == Node::CLASS_DEFINE) {
+            Class &c = classes[statement->var_name];
+
+            std::uint32_t fields = 0;
+            for (auto &&property : statement->class_def->properties) {
+                if (property.node->kind == Node::VAR_DEF) {
+                    c.properties[property.name] = {fields++, property.access_type, property.node};
+                }
+            }
+
+            std::uint32_t slots = 0;
+            for (auto &&method : statement->class_def->methods) {
+                if (method.node->kind == Node::FUNCTION_DEFINE) {
+                    c.methods[method.name] = {slots++, method.access_type, method.node};
+                }
+            }
+        }
+    }
+}
+
+const Resolver::Class &Resolver::class_named(const Node *n, Symbol name) {
+    auto found = classes.find(name);
+    if (found == std::end(classes)) {
+        error(n->location.line, "class '" + name.str() + "' is not defined");
+    }
+    return found->second;
+}
+
+const Resolver::Member &Resolver::property(const Node *n, Symbol class_name) {
+    const Class &c = class_named(n, class_name);
+    auto found = c.properties.find(n->property_name);
+    if (found == std::end(c.properties)) {
+        error(n->location.line, "member '" + n->property_name.str() + "' of class '" + class_name.str() + "' is not a property");
+    }
+    return found->second;
+}
+
+const Resolver::Member &Resolver::method(const Node *n, Symbol class_name, Symbol name) {
+    const Class &c = class_named(n, class_name);
+    auto found = c.methods.find(name);
+    if (found == std::end(c.methods)) {
+        error(n->location.line, "class '" + class_name.str() + "' has no method named '" + name.str() + "'");
+    }
+    return found->second;
+}
+
+void Resolver::check_access(const Node *n, const Member &member, const std::string &what) {
+    if (member.access_type == Node::PRIVATE || member.access_type == Node::PROTECTED) {
+        error(n->location.line, what + " is private");
+    }
+}
+
+void Resolver::check_arguments(const Node *n, const Node *function) {
+    std::size_t expected = function->o1->func_def_args->size();
+    if (n->func_call_args.size() != expected) {
+        error(
+                n->location.line,
+                "invalid number arguments (" +
+                std::to_string(n->func_call_args.size()) +
+                "), expected " +
+                std::to_string(expected)
+        );
+    }
+}
+
+// an object is assigned or initialized from another object, they have to be of one class
+void Resolver::check_object(const Node *n) {
+    const Node *value = n->o1;
+    bool object = value->value_type == Node::USER &&
+                  (value->kind == Node::VAR_ACCESS || value->kind == Node::FUNCTION_CALL || value->kind == Node::METHOD_CALL);
+
+    if (object && (n->value_type != value->value_type || n->user_type != value->user_type)) {
+        error(
+                n->location.line,
+                "types of objects '"
+                + n->var_name.str()
+                + "' ("
+                + type_name(n)
+                + ") and '"
+                + value->var_name.str()
+                + "' ("
+                + type_name(value)
+                + ") does not match!"
+        );
+    }
+}
+
+std::uint32_t Resolver::declare(Symbol name, unsigned char storage, unsigned char value_type, Symbol user_type) {
+    Variable &entry = table[name];
+    scopes.declare(name, entry);
+    entry = {frame_size++, storage, value_type, user_type};
+    return entry.slot;
+}
+
+void Resolver::declare(Node *n, unsigned char storage) {
+    if (!framed) {
+        error(n->location.line, "variable '" + n->var_name.str() + "' is defined outside of a function");
+    }
+
+    n->resolved.slot = declare(n->var_name, storage, n->value_type, n->user_type);
+    n->storage = storage;
+}
+
+const Resolver::Variable &Resolver::bind(Node *n) {
+    auto found = table.find(n->var_name);
+    if (found == std::end(table)) {
+        error(n->location.line, "variable '" + n->var_name.str() + "' is not defined");
+    }
+
+    n->resolved.slot = found->second.slot;
+    n->storage = found->second.storage;
+    return found->second;
+}
+
+void Resolver::enter_scope() {
+    scopes.push();
+}
+
+void Resolver::leave_scope() {
+    scopes.pop([this](Symbol name, const Variable &previous) {
+        if (previous.storage != Node::UNRESOLVED) {
+            table[name] = previous;
+        } else {
+            table.erase(name);
+        }
+    });
+}
+
+// a function or, with its class, a method, in a frame of its own: the
+// variables of the code around it are not its to use
+void Resolver::function(Node *n, Symbol class_name) {
+    if (class_name.empty() && n->var_name == names::main) {
+        n->value_type = Node::INTEGER; // whatever it was declared to return
+    }
+
+    auto outer_table = std::move(table);
+    table.clear();
+    bool outer_framed = framed;
+    framed = true;
+    std::uint32_t outer = frame_size;
+    frame_size = 0;
+
+    enter_scope();
+    if (!class_name.empty()) {
+        declare(names::self, Node::OBJECT_POINTER, Node::USER, class_name);
+    }
+    for (auto &&argument : *n->o1->func_def_args) { // in the order of the prototype's arguments
+        const types::Type &type = *argument.second;
+        declare(argument.first, storage_of(type.value_type, true), static_cast<unsigned char>(type.value_type), type.user_type_name);
+    }
+
+    resolve_node(n->o2);
+    leave_scope();
+
+    n->frame_size = frame_size;
+    frame_size = outer;
+    framed = outer_framed;
+    table = std::move(outer_table);
+}
+
+void Resolver::resolve_node(Node *n) {
+    if (n == nullptr) {
+        return;
+    }
+
+    switch (n->kind) {
+        case Node::VAR_ACCESS:
+            bind(n);
+            break;
+        case Node::INPUT: {
+            const Variable &variable = bind(n);
+            n->value_type = variable.value_type;
+            n->user_type = variable.user_type;
+            break;
+        }
+        case Node::ARRAY_ACCESS:
+            resolve_node(n->o1);
+            bind(n);
+            break;
+        case Node::PROPERTY_ACCESS: {
+            bind(n);
+
+            const Member &field = property(n, n->user_type);
+            if (n->var_name != names::self) {
+                check_access(n, field, "property '" + n->property_name.str() + "' of object '" + n->var_name.str() + "'");
+            }
+            n->resolved.field = field.index;
+            break;
+        }
+        case Node::FUNC_OBJ_PROPERTY_ACCESS: {
+            resolve_node(n->o1);
+
+            const Member &field = property(n, n->user_type);
+            check_access(n, field, "property '" + n->property_name.str() + "' of object '" + n->var_name.str() + "'");
+            n->resolved.field = field.index;
+            break;
+        }
+        case Node::FUNCTION_CALL: {
+            for (Node *argument : n->func_call_args) {
+                resolve_node(argument);
+            }
+
+            auto callee = functions.find(n->var_name);
+            if (callee == std::end(functions)) {
+                error(n->location.line, "function '" + n->var_name.str() + "' is not defined");
+            }
+            check_arguments(n, callee->second);
+            break;
+        }
+        case Node::METHOD_CALL:
+        case Node::FUNC_OBJ_METHOD_CALL: {
+            resolve_node(n->o1); // the object
+            for (Node *argument : n->func_call_args) {
+                resolve_node(argument);
+            }
+
+            const Member &callee = method(n, n->o1->user_type, n->property_name);
+            if (n->var_name != names::self) {
+                check_access(n, callee, "method '" + n->property_name.str() + "' of object " +
+                                        (n->kind == Node::METHOD_CALL ? "" : "returned by function ") + "'" + n->var_name.str() + "'");
+            }
+            check_arguments(n, callee.node);
+            break;
+        }
+        case Node::OBJECT_CONSTRUCT: {
+            for (Node *argument : n->func_call_args) {
+                resolve_node(argument);
+            }
+            check_arguments(n, method(n, n->var_name, n->var_name).node);
+            break;
+        }
+        case Node::SET: {
+            resolve_node(n->o1);
+            resolve_node(n->o2); // the index of an array element
+            check_object(n);
+            bind(n);
+
+            if (!n->property_name.empty()) {
+                const Member &field = property(n, n->user_type);
+                if (n->var_name != names::self) {
+                    check_access(n, field, "property '" + n->property_name.str() + "' of object '" + n->var_name.str() + "'");
+                }
+                n->resolved.field = field.index;
+            }
+            break;
+        }
+        case Node::INIT:
+            resolve_node(n->o1); // before the variable is declared, as the parser saw it
+            check_object(n);
+            declare(n, storage_of(n->value_type, false));
+            break;
+        case Node::VAR_DEF:
+            if (n->o1 != nullptr && n->o1->kind == Node::ARRAY) {
+                resolve_node(n->o1->o1); // the number of elements
+                declare(n, Node::ELEMENTS);
+            } else {
+                declare(n, storage_of(n->value_type, false));
+            }
+            break;
+        case Node::DELETE:
+            table.erase(n->var_name);
+            break;
+        case Node::REPEAT:
+            resolve_node(n->o1);
+            if (!framed) {
+                error(n->location.line, "loop 'repeat' is outside of a function");
+            }
+            n->resolved.slot = declare(names::index, Node::SCALAR, Node::INTEGER, Symbol()); // the counter, declared in the scope around the loop
+            n->storage = Node::SCALAR;
+
+            enter_scope();
+            resolve_node(n->o2);
+            leave_scope();
+            break;
+        case Node::IF:
+        case Node::WHILE:
+            resolve_node(n->o1);
+            enter_scope();
+            resolve_node(n->o2);
+            leave_scope();
+            break;
+        case Node::ELSE:
+            resolve_node(n->o1);
+            enter_scope();
+            resolve_node(n->o2);
+            leave_scope();
+            enter_scope();
+            resolve_node(n->o3);
+            leave_scope();
+            break;
+        case Node::DO:
+            enter_scope();
+            resolve_node(n->o1);
+            leave_scope();
+            resolve_node(n->o2);
+            break;
+        case Node::FUNCTION_DEFINE:
+            function(n, Symbol());
+            break;
+        case Node::CLASS_DEFINE:
+            for (auto &&method : n->class_def->methods) {
+                if (method.node->kind == Node::FUNCTION_DEFINE && methods_done.insert(method.node).second) {
+                    function(method.node, n->var_name);
+                }
+            }
+            break;
+        case Node::BLOCK:
+            for (Node *statement : n->statements) {
+                resolve_node(statement);
+            }
+            break;
+        case Node::CONST:
+        case Node::ARG:
+        case Node::ARG_LIST:
+        case Node::EMPTY:
+            break;
+        default: // operators, EXPR, PRINTLN, RETURN
+            resolve_node(n->o1);
+            resolve_node(n->o2);
+            resolve_node(n->o3);
+    }
+}
+
+void Resolver::resolve(Node *root) {
+    declare_ahead(root);
+    resolve_node(root);
+}
@@ -0,0 +1,76 @@
+//
+// Created by NEzyaka on 17.10.26.
+//
+
+#ifndef TURNIP2_RESOLVER_H
+#define TURNIP2_RESOLVER_H
+
+#include "scope.h"
+#include "utilities.h"
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace turnip2;
+
+// Binds the names of a parsed tree before code is generated. Every variable
+// gets a slot in the frame of its function, the arguments first ('this' of
+// a method before them), and every node naming one is marked with that slot
+// and with what the slot holds; a property access gets the index of its
+// field. A function sees only its own variables, the top level has none.
+// The checks that compare declarations with their uses (objects of two
+// classes, private members, numbers of arguments) are made here, the
+// generator trusts the tree. Errors are thrown like Parser::parse() does.
+class Resolver {
+    struct Variable {
+        std::uint32_t slot = 0;
+        unsigned char storage = Node::UNRESOLVED; // UNRESOLVED: not declared
+        unsigned char value_type = Node::VOID;
+        Symbol user_type;
+    };
+
+    struct Member {
+        std::uint32_t index; // of the field, or of the method among the methods
+        int access_type;
+        const Node *node;
+    };
+
+    // the layout the generator gives a class: fields in declaration order
+    struct Class {
+        std::unordered_map<Symbol, Member> properties;
+        std::unordered_map<Symbol, Member> methods;
+    };
+
+    std::unordered_map<Symbol, Class> classes;
+    std::unordered_map<Symbol, const Node *> functions; // FUNCTION_DEFINE of every function
+    std::unordered_map<Symbol, Variable> table; // innermost variable of every name in the function being resolved
+    Scopes<Variable> scopes;
+    bool framed = false; // a function is being resolved
+    std::uint32_t frame_size = 0; // slots it has taken
+    std::unordered_set<const Node *> methods_done; // a derived class lists the methods of its base again
+
+    void error(unsigned line, const std::string &e);
+
+    void declare_ahead(const Node *root); // classes and functions may be used above their definition
+    const Class &class_named(const Node *n, Symbol name);
+    const Member &property(const Node *n, Symbol class_name);
+    const Member &method(const Node *n, Symbol class_name, Symbol name);
+    void check_access(const Node *n, const Member &member, const std::string &what);
+    void check_arguments(const Node *n, const Node *function);
+    void check_object(const Node *n);
+
+    void declare(Node *n, unsigned char storage);
+    std::uint32_t declare(Symbol name, unsigned char storage, unsigned char value_type, Symbol user_type);
+    const Variable &bind(Node *n);
+    void enter_scope();
+    void leave_scope();
+    void function(Node *n, Symbol class_name);
+    void resolve_node(Node *n);
+
+public:
+    void resolve(Node *root);
+};
+
+
+#endif //TURNIP2_RESOLVER_H
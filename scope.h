@@ -0,0 +1,53 @@
+//
+// Created by NEzyaka on 17.10.26.
+//
+
+#ifndef TURNIP2_SCOPE_H
+#define TURNIP2_SCOPE_H
+
+#include "symbol.h"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace turnip2 {
+    // Block scopes over a flat symbol table. The table always holds the
+    // innermost meaning of every name; this keeps, for each declaration,
+    // what the name meant before it, so leaving a scope costs only the
+    // names declared in it. A default T is "not declared".
+    template <typename T>
+    class Scopes {
+        std::vector<std::pair<Symbol, T>> shadowed;
+        std::vector<std::size_t> marks; // size of 'shadowed' when each open scope began
+
+    public:
+        void push() {
+            marks.emplace_back(shadowed.size());
+        }
+
+        // 'name' is being bound in the innermost scope, it meant 'previous'
+        // until now; declarations outside every scope are never undone
+        void declare(Symbol name, T previous) {
+            if (!marks.empty()) {
+                shadowed.emplace_back(name, std::move(previous));
+            }
+        }
+
+        // closes the innermost scope, restore(name, previous) puts back the
+        // older meaning of every name it declared, newest first
+        template <typename F>
+        void pop(F &&restore) {
+            for (std::size_t i = shadowed.size(); i-- > marks.back();) {
+                restore(shadowed[i].first, std::move(shadowed[i].second));
+            }
+            shadowed.resize(marks.back());
+            marks.pop_back();
+        }
+
+        std::size_t depth() const { return marks.size(); }
+    };
+}
+
+
+#endif //TURNIP2_SCOPE_H
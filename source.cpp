@@ -0,0 +1,141 @@
+//
+// Created by NEzyaka on 17.10.26.
+//
+
+#include "source.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+
+Source::Source(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::string(" cannot open file: " + std::string(strerror(errno)));
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *addr = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+#if defined(MADV_SEQUENTIAL)
+            madvise(addr, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL); // the lexer reads the file front to back
+#endif
+            data = static_cast<const char *>(addr);
+            size = static_cast<std::size_t>(st.st_size);
+            mapped = true;
+        }
+    }
+
+    if (!mapped) {
+        read_fallback(fd);
+    }
+
+    close(fd);
+}
+
+Source::~Source() {
+    if (mapped) {
+        munmap(const_cast<char *>(data), size);
+    }
+}
+
+void Source::read_fallback(int fd) {
+    char chunk[65536];
+    ssize_t n;
+
+    while ((n = read(fd, chunk, sizeof(chunk))) != 0) {
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            close(fd);
+            throw std::string(" cannot read file: " + std::string(strerror(errno)));
+        }
+
+        buffer.insert(std::end(buffer), chunk, chunk + n);
+    }
+
+    data = buffer.data();
+    size = buffer.size();
+}
+
+Stream::Stream(const std::string &path) {
+    if (path == "-") {
+        fd = STDIN_FILENO;
+        return;
+    }
+
+    fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::string(" cannot open file: " + std::string(strerror(errno)));
+    }
+
+    owned = true;
+}
+
+Stream::~Stream() {
+    if (owned) {
+        close(fd);
+    }
+}
+
+std::size_t Stream::read(char *to, std::size_t n) {
+    ssize_t got;
+    while ((got = ::read(fd, to, n)) == -1) {
+        if (errno != EINTR) {
+            throw std::string(" cannot read file: " + std::string(strerror(errno)));
+        }
+    }
+
+    return static_cast<std::size_t>(got);
+}
+
+#else
+
+Source::Source(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::string(" cannot open file: " + path);
+    }
+
+    buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    data = buffer.data();
+    size = buffer.size();
+}
+
+Source::~Source() = default;
+
+Stream::Stream(const std::string &path) {
+    if (path == "-") {
+        return;
+    }
+
+    file.open(path, std::ios::binary);
+    if (!file) {
+        throw std::string(" cannot open file: " + path);
+    }
+
+    owned = true;
+}
+
+Stream::~Stream() = default;
+
+std::size_t Stream::read(char *to, std::size_t n) {
+    std::istream &in = owned ? static_cast<std::istream &>(file) : std::cin;
+    in.read(to, static_cast<std::streamsize>(n));
+    return static_cast<std::size_t>(in.gcount());
+}
+
+#endif
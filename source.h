@@ -0,0 +1,54 @@
+//
+// Created by NEzyaka on 17.10.26.
+//
+
+#ifndef TURNIP2_SOURCE_H
+#define TURNIP2_SOURCE_H
+
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read-only view of a source file. The file is mapped into memory when the
+// platform allows it, so the lexer scans the page cache directly instead of
+// a private copy of the input.
+class Source {
+    const char *data = nullptr;
+    std::size_t size = 0;
+    bool mapped = false;
+
+    std::vector<char> buffer; // storage for inputs that cannot be mapped (pipes, empty files)
+
+    void read_fallback(int fd);
+
+public:
+    explicit Source(const std::string &path);
+    ~Source();
+
+    Source(const Source &) = delete;
+    Source &operator=(const Source &) = delete;
+
+    std::string_view view() const { return {data, size}; }
+};
+
+// Sequential reader for inputs that are lexed without ever being whole in
+// memory. The path "-" reads stdin.
+class Stream {
+    int fd = -1;
+    bool owned = false;
+
+    std::ifstream file; // used where there are no file descriptors
+
+public:
+    explicit Stream(const std::string &path);
+    ~Stream();
+
+    Stream(const Stream &) = delete;
+    Stream &operator=(const Stream &) = delete;
+
+    std::size_t read(char *to, std::size_t n); // up to n bytes, 0 at the end of the input
+};
+
+
+#endif //TURNIP2_SOURCE_H
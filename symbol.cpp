@@ -0,0 +1,88 @@
+//
+// Created by NEzyaka on 17.10.26.
+//
+
+#include "symbol.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+    constexpr std::size_t SHARDS = 64; // names are interned by all parser threads at once, each shard has a lock of its own
+    constexpr std::size_t PAGE = 1 << 16; // spellings per page of the id table
+    constexpr std::size_t PAGES = 1 << 16;
+
+    struct Shard {
+        std::mutex lock;
+        std::deque<std::string> names; // a deque never moves its strings, the index keys view them
+        std::unordered_map<std::string_view, std::uint32_t> index;
+    };
+
+    // Spellings by id, in pages that are never moved or freed: str() reads
+    // them without a lock. An id only reaches another thread through
+    // something that orders it after its entry was written.
+    struct Table {
+        Shard shards[SHARDS];
+        std::atomic<std::uint32_t> next{0};
+        std::mutex grow;
+        std::atomic<const std::string **> pages[PAGES] = {};
+
+        Table() {
+            add(""); // id 0, the empty name
+        }
+
+        const std::string **page(std::uint32_t id) {
+            auto &p = pages[id / PAGE];
+            const std::string **entries = p.load(std::memory_order_acquire);
+            if (entries == nullptr) {
+                std::lock_guard<std::mutex> guard(grow);
+                entries = p.load(std::memory_order_relaxed);
+                if (entries == nullptr) {
+                    entries = new const std::string *[PAGE];
+                    p.store(entries, std::memory_order_release);
+                }
+            }
+            return entries;
+        }
+
+        std::uint32_t add(std::string_view name) {
+            Shard &shard = shards[std::hash<std::string_view>()(name) % SHARDS];
+            std::lock_guard<std::mutex> guard(shard.lock);
+
+            auto found = shard.index.find(name);
+            if (found != std::cend(shard.index)) {
+                return found->second;
+            }
+
+            std::uint32_t id = next.fetch_add(1, std::memory_order_relaxed);
+            shard.names.emplace_back(name);
+            page(id)[id % PAGE] = &shard.names.back();
+            shard.index.emplace(shard.names.back(), id);
+
+            return id;
+        }
+    };
+
+    Table &table() {
+        static Table t;
+        return t;
+    }
+}
+
+namespace turnip2 {
+    Symbol intern(std::string_view name) {
+        return Symbol(table().add(name));
+    }
+
+    const std::string &Symbol::str() const {
+        return *table().pages[id / PAGE].load(std::memory_order_acquire)[id % PAGE];
+    }
+
+    namespace names {
+        const Symbol self = intern("this");
+        const Symbol index = intern("index");
+        const Symbol main = intern("main");
+    }
+}
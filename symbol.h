@@ -0,0 +1,52 @@
+//
+// Created by NEzyaka on 17.10.26.
+//
+
+#ifndef TURNIP2_SYMBOL_H
+#define TURNIP2_SYMBOL_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace turnip2 {
+    // Interned identifier. Every spelling is hashed once, when it is interned;
+    // symbol tables then hash and compare the 32-bit id instead of the string.
+    // Interning and str() are safe from any number of threads.
+    class Symbol {
+        std::uint32_t id = 0; // 0 is the empty name
+
+        explicit Symbol(std::uint32_t i) : id(i) {}
+        friend Symbol intern(std::string_view name);
+
+    public:
+        Symbol() = default;
+
+        std::uint32_t index() const { return id; }
+        bool empty() const { return id == 0; }
+        const std::string &str() const;
+
+        bool operator==(Symbol other) const { return id == other.id; }
+        bool operator!=(Symbol other) const { return id != other.id; }
+    };
+
+    Symbol intern(std::string_view name);
+
+    // names the compiler refers to itself
+    namespace names {
+        extern const Symbol self;  // "this"
+        extern const Symbol index; // counter of a 'repeat' loop
+        extern const Symbol main;  // where the program starts, returns int
+    }
+}
+
+namespace std {
+    template<>
+    struct hash<turnip2::Symbol> {
+        size_t operator()(turnip2::Symbol s) const noexcept { return s.index(); }
+    };
+}
+
+
+#endif //TURNIP2_SYMBOL_H
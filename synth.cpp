@@ -0,0 +1,262 @@
+//
+// Created by NEzyaka on 17.10.26.
+//
+
+#include "synth.h"
+
+#include <algorithm>
+
+namespace {
+    class Synth {
+        const SynthOptions &options;
+        std::uint64_t state;
+        std::string out;
+
+        unsigned function = 0; // index of the function being written, it may call the ones before it
+        unsigned declared = 0; // locals declared so far, only those may be read
+        bool object = false;   // the function has a local 'object' of some class
+
+        // splitmix64, unlike the <random> distributions it gives the same
+        // sequence with every standard library
+        std::uint64_t next() {
+            std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            return z ^ (z >> 31);
+        }
+
+        unsigned below(unsigned n) {
+            return n != 0 ? static_cast<unsigned>(next() % n) : 0;
+        }
+
+        bool chance(unsigned percent) {
+            return below(100) < percent;
+        }
+
+        void indent(unsigned level) {
+            out.append(4 * level, ' ');
+        }
+
+        void local() {
+            if (declared == 0 || below(4) == 0) {
+                out += below(2) == 0 ? "a" : "b"; // the arguments
+            } else {
+                out += "local_" + std::to_string(below(declared));
+            }
+        }
+
+        void assignee() {
+            if (options.identifiers == 0) {
+                out += "a";
+            } else {
+                out += "local_" + std::to_string(below(options.identifiers));
+            }
+        }
+
+        void operand(unsigned level) {
+            if (level < options.nesting && chance(25)) {
+                out += "(";
+                expression(level + 1);
+                out += ")";
+            } else if (chance(options.literals)) {
+                out += std::to_string(1 + below(999));
+            } else {
+                local();
+            }
+        }
+
+        void expression(unsigned level = 0) {
+            static const char *const operators[] = {" + ", " - ", " * "};
+
+            operand(level);
+            for (unsigned n = below(options.operators + 1); n != 0; n--) {
+                out += operators[below(3)];
+                operand(level);
+            }
+        }
+
+        void block(unsigned level, unsigned budget) {
+            out += "{\n";
+            while (budget != 0) {
+                budget -= statement(level + 1, budget);
+            }
+            indent(level);
+            out += "}";
+        }
+
+        // writes one statement and returns how many of the budget it used
+        unsigned statement(unsigned level, unsigned budget) {
+            bool nest = level <= options.depth && budget >= 3;
+
+            indent(level);
+            switch (below(nest ? 7 : 5)) {
+                case 0: // a call, once there are functions before this one
+                    if (function != 0) {
+                        assignee();
+                        out += " = fn_" + std::to_string(below(function)) + "(";
+                        expression();
+                        out += ", ";
+                        expression();
+                        out += ");\n";
+                        return 1;
+                    }
+                    // fall through
+                case 1:
+                    if (object) {
+                        assignee();
+                        if (below(2) == 0) {
+                            out += " = object.get();\n";
+                        } else {
+                            out += " = object.add(";
+                            expression();
+                            out += ");\n";
+                        }
+                        return 1;
+                    }
+                    // fall through
+                case 2:
+                    out += "println ";
+                    if (chance(options.literals)) {
+                        out += "\"line " + std::to_string(below(1000)) + "\"";
+                    } else {
+                        local();
+                    }
+                    out += ";\n";
+                    return 1;
+                case 5: {
+                    unsigned inner = 1 + below(budget - 1);
+
+                    out += "if ";
+                    local();
+                    out += " < ";
+                    expression();
+                    out += " ";
+                    if (inner >= 2 && below(2) == 0) {
+                        block(level, inner / 2);
+                        out += " else ";
+                        block(level, inner - inner / 2);
+                    } else {
+                        block(level, inner);
+                    }
+                    out += "\n";
+                    return 1 + inner;
+                }
+                case 6: {
+                    unsigned inner = 1 + below(budget - 1);
+
+                    out += "while ";
+                    local();
+                    out += " < 1000 ";
+                    block(level, inner);
+                    out += "\n";
+                    return 1 + inner;
+                }
+                default:
+                    assignee();
+                    out += " = ";
+                    expression();
+                    out += ";\n";
+                    return 1;
+            }
+        }
+
+        void class_def(unsigned index) {
+            std::string name = "Class_" + std::to_string(index);
+
+            if (index % 3 == 2) { // every third class derives from the one before
+                out += "class " + name + " <- Class_" + std::to_string(index - 1) + " {\n"
+                        "    public function " + name + "(v: int) {\n"
+                        "        this.value = v * 2;\n"
+                        "    }\n"
+                        "\n"
+                        "    override public function get() : int {\n"
+                        "        return this.value + " + std::to_string(index) + ";\n"
+                        "    }\n"
+                        "};\n\n";
+                return;
+            }
+
+            out += "class " + name + " {\n"
+                    "    public value: int;\n"
+                    "    private count: int;\n"
+                    "\n"
+                    "    public function " + name + "(v: int) {\n"
+                    "        this.value = v;\n"
+                    "        this.count = 0;\n"
+                    "    }\n"
+                    "\n"
+                    "    public function get() : int {\n"
+                    "        return this.value;\n"
+                    "    }\n"
+                    "\n"
+                    "    public function add(i: int) : int {\n"
+                    "        this.value = this.value + i;\n"
+                    "        this.count = this.count + 1;\n"
+                    "        return this.value;\n"
+                    "    }\n"
+                    "};\n\n";
+        }
+
+        void function_def() {
+            out += "// fn_" + std::to_string(function) + "\n";
+            out += "function fn_" + std::to_string(function) + "(a: int, b: int) : int {\n";
+
+            for (declared = 0; declared != options.identifiers; declared++) {
+                out += "    var local_" + std::to_string(declared) + ": int = ";
+                expression();
+                out += ";\n";
+            }
+
+            object = options.classes != 0;
+            if (object) {
+                std::string type = "Class_" + std::to_string(below(options.classes));
+                out += "    var object: " + type + " = " + type + "(";
+                expression();
+                out += ");\n";
+            }
+
+            for (unsigned budget = options.statements; budget != 0;) {
+                budget -= statement(1, budget);
+            }
+
+            out += "    return ";
+            local();
+            out += ";\n}\n\n";
+            function++;
+        }
+
+    public:
+        explicit Synth(const SynthOptions &o) : options(o), state(o.seed) {}
+
+        std::string run() {
+            out += "// synthetic program, seed " + std::to_string(options.seed) + "\n\n";
+
+            for (unsigned i = 0; i != options.classes; i++) {
+                class_def(i);
+            }
+
+            if (options.size != 0) {
+                while (out.size() < options.size) {
+                    function_def();
+                }
+            } else {
+                while (function != options.functions) {
+                    function_def();
+                }
+            }
+
+            out += "function main() {\n    var total: int = 0;\n";
+            unsigned calls = std::min(function, std::max(options.statements, 1u));
+            for (unsigned i = function - calls; i != function; i++) {
+                out += "    total = total + fn_" + std::to_string(i) + "(" + std::to_string(i) + ", 1);\n";
+            }
+            out += "    println total;\n}\n";
+
+            return std::move(out);
+        }
+    };
+}
+
+std::string synthesize(const SynthOptions &options) {
+    return Synth(options).run();
+}
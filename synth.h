@@ -0,0 +1,32 @@
+//
+// Created by NEzyaka on 17.10.26.
+//
+
+#ifndef TURNIP2_SYNTH_H
+#define TURNIP2_SYNTH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Shape of a synthetic Turnip2 program. The same options and seed always
+// produce the same text, on every platform.
+struct SynthOptions {
+    unsigned functions = 100;
+    unsigned classes = 10;
+    unsigned statements = 20; // per function body, nested blocks included
+    unsigned depth = 2;       // deepest nesting of 'if' and 'while' blocks
+    unsigned identifiers = 8; // local variables of every function
+    unsigned literals = 50;   // percent of operands that are literals instead of variables
+    unsigned operators = 2;   // most binary operators in one expression
+    unsigned nesting = 0;     // deepest parenthesized sub-expression
+    std::size_t size = 0;     // when set, functions are added until the text is this long
+    std::uint64_t seed = 1;
+};
+
+// A program the front end accepts: classes first, then functions that only
+// call functions and construct classes defined above them, then main.
+std::string synthesize(const SynthOptions &options);
+
+
+#endif //TURNIP2_SYNTH_H
@@ -0,0 +1,41 @@
+//
+// Created by NEzyaka on 17.10.26.
+//
+
+// The line of an error met in the last chunk of an input lexed on several
+// threads is the same as on one thread.
+
+#include "lexer.h"
+
+#include <iostream>
+#include <string>
+
+int main() {
+    std::string text; // 8 MiB, cut in four chunks of more than MIN_CHUNK bytes each
+    unsigned lines = 0;
+    while (text.size() < (8u << 20)) {
+        text += "var x: int = 1; // a line\n";
+        lines++;
+    }
+    text += "println \"no end\n";
+    lines++;
+
+    std::string expected = std::to_string(lines) + " -> ";
+    for (unsigned threads : {1u, 4u}) {
+        Lexer lexer;
+        lexer.load(text);
+
+        try {
+            lexer.tokenize(threads);
+            std::cerr << threads << " threads: no error reported" << std::endl;
+            return 1;
+        } catch (const std::string &e) {
+            if (e.compare(0, expected.size(), expected) != 0) {
+                std::cerr << threads << " threads: expected the error on line " << lines << ", got '" << e << "'" << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,121 @@
+//
+// Created by NEzyaka on 17.10.26.
+//
+
+// A function or method body sees the top-level variables declared above its
+// definition, whether it is a block or a single statement and however many
+// threads parse the bodies.
+
+#include "arena.h"
+#include "lexer.h"
+#include "parser.h"
+
+#include <iostream>
+#include <string>
+
+namespace {
+    struct Example {
+        const char *name;
+        const char *text;
+        const char *error; // the start of the error expected, nullptr when it parses
+    };
+
+    const Example examples[] = {
+            {
+                    "a later global in a block",
+                    "function f() : int {\n"
+                    "    return later;\n"
+                    "}\n"
+                    "var later: int = 1;\n",
+                    "2 -> 'later' was not declared in this scope"
+            },
+            {
+                    "a later global in a single statement",
+                    "function f() : int\n"
+                    "    return later;\n"
+                    "var later: int = 1;\n",
+                    "2 -> 'later' was not declared in this scope"
+            },
+            {
+                    "a later global in a method",
+                    "class A {\n"
+                    "    public v: int;\n"
+                    "    public function set(i: int)\n"
+                    "        this.v = later;\n"
+                    "};\n"
+                    "var later: int = 1;\n",
+                    "4 -> 'later' was not declared in this scope"
+            },
+            {
+                    "an earlier global in both forms",
+                    "var g: int = 1;\n"
+                    "function f() : int\n"
+                    "    return g;\n"
+                    "function h() : int {\n"
+                    "    return g;\n"
+                    "}\n",
+                    nullptr
+            },
+            {
+                    "a top-level del after the function",
+                    "var x: int = 1;\n"
+                    "function f() : int {\n"
+                    "    return x;\n"
+                    "}\n"
+                    "del x;\n"
+                    "function main() {\n"
+                    "    println f();\n"
+                    "}\n",
+                    nullptr
+            },
+            {
+                    "a top-level del after the class",
+                    "var x: int = 1;\n"
+                    "class A {\n"
+                    "    public v: int;\n"
+                    "    public function set(i: int)\n"
+                    "        this.v = i + x;\n"
+                    "    public function get() : int {\n"
+                    "        return this.v + x;\n"
+                    "    }\n"
+                    "};\n"
+                    "del x;\n",
+                    nullptr
+            },
+            {
+                    "a top-level del before the function",
+                    "var x: int = 1;\n"
+                    "del x;\n"
+                    "function f() : int {\n"
+                    "    return x;\n"
+                    "}\n",
+                    "4 -> 'x' was not declared in this scope"
+            },
+    };
+}
+
+int main() {
+    int failed = 0;
+
+    for (auto &&example : examples) {
+        for (unsigned threads : {1u, 4u}) {
+            std::string got;
+            try {
+                Lexer lexer;
+                lexer.load(example.text);
+                Arena arena;
+                Parser(&lexer, &arena, threads).parse();
+            } catch (const std::string &e) {
+                got = e;
+            }
+
+            std::string expected = example.error != nullptr ? example.error : "";
+            if (got.compare(0, expected.size(), expected) != 0 || (expected.empty() && !got.empty())) {
+                std::cerr << example.name << ", " << threads << " threads: expected '" << expected << "', got '" << got << "'" << std::endl;
+                failed = 1;
+            }
+        }
+    }
+
+    return failed;
+}
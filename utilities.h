@@ -6,50 +6,153 @@
 #define TURNIP2_UTILITIES_H
 
 #include "location.h"
+#include "symbol.h"
+#include <cstdint>
 #include <memory>
 #include <unordered_map>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <utility>
 
 namespace turnip2 {
     class Node;
     namespace types {
         struct Type {
-            Type(int t, std::string n) {
+            Type(int t, Symbol n) {
                 value_type = t;
                 user_type_name = n;
             }
 
             int value_type;
-            std::string user_type_name;
+            Symbol user_type_name;
         };
 
         struct Member {
-            Member(std::shared_ptr<Type> t, std::shared_ptr<Node> n, unsigned short a)
-                : type(t), ast_node(n), access_type(a) {}
+            enum kind {
+                PROPERTY,
+                METHOD
+            };
 
+            Member(Symbol nm, unsigned short k, std::shared_ptr<Type> t, Node *n, unsigned short a)
+                : name(nm), kind(k), type(t), ast_node(n), access_type(a) {}
+
+            Symbol name;
+            unsigned short kind;
             std::shared_ptr<Type> type;
-            std::shared_ptr<Node> ast_node;
+            Node *ast_node;
             unsigned short access_type;
         };
 
+        // The members of a class in the order they were declared, those of
+        // its base first, with one index over properties and methods alike:
+        // a member access is resolved with a single lookup.
         struct AbstractType {
-            AbstractType(std::unordered_map<std::string, std::shared_ptr<Member>> p,
-                         std::unordered_map<std::string, std::shared_ptr<Member>> m)
-                : properties(p), methods(m) {}
+            std::vector<std::shared_ptr<Member>> members;
+            std::unordered_map<Symbol, std::uint32_t> index;
+
+            // nullptr if the class has no member by that name
+            const Member *find(Symbol name) const {
+                auto at = index.find(name);
+                return at != std::end(index) ? members[at->second].get() : nullptr;
+            }
+
+            // adds the member or puts it in the place of the one of that name
+            void define(std::shared_ptr<Member> member) {
+                auto at = index.emplace(member->name, static_cast<std::uint32_t>(members.size()));
+                if (at.second) {
+                    members.push_back(std::move(member));
+                } else {
+                    members[at.first->second] = std::move(member);
+                }
+            }
 
-            std::unordered_map<std::string, std::shared_ptr<Member>> properties;
-            std::unordered_map<std::string, std::shared_ptr<Member>> methods;
+            // drops the member and closes the gap it leaves in 'members'
+            void remove(Symbol name) {
+                auto at = index.find(name);
+                if (at == std::end(index)) {
+                    return;
+                }
+
+                std::uint32_t i = at->second;
+                index.erase(at);
+                members.erase(std::begin(members) + i);
+                for (auto &&entry : index) {
+                    if (entry.second > i) {
+                        entry.second--;
+                    }
+                }
+            }
         };
     }
 
-    class Node {
+    // A run of nodes allocated in the Arena, the arguments of a call.
+    class NodeList {
+        Node **items;
+        std::uint32_t count;
+
     public:
-        explicit Node(unsigned short k = 255, std::shared_ptr<class Node> op1 = nullptr,
-                      std::shared_ptr<class Node> op2 = nullptr, std::shared_ptr<class Node> op3 = nullptr)
-            : kind(k), o1(op1), o2(op2), o3(op3) {}
+        NodeList(Node **i = nullptr, std::uint32_t n = 0) : items(i), count(n) {}
 
-        Location location;
+        Node **begin() const { return items; }
+        Node **end() const { return items + count; }
+        std::uint32_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        Node *operator[](std::uint32_t i) const { return items[i]; }
+    };
+
+    // Members of a class definition, allocated in the Arena next to the
+    // CLASS_DEFINE node instead of inside every node. Both lists are in
+    // declaration order, those of the base class first: the properties are
+    // the fields of the class in that order, the constructor is the last
+    // method.
+    struct ClassBody {
+        struct Member {
+            Symbol name;
+            int access_type;
+            Node *node;
+        };
+
+        std::vector<Member> properties;
+        std::vector<Member> methods;
+    };
+
+    // The arguments of a function, hung off its ARG_LIST node. They are kept
+    // in the order they were declared, which is the order of the parameters;
+    // the index only finds one by name.
+    struct ArgTypes {
+        using Argument = std::pair<Symbol, std::shared_ptr<types::Type>>;
+
+        std::vector<Argument> arguments;
+        std::unordered_map<Symbol, std::uint32_t> index;
+
+        // false, and nothing added, if there is an argument by that name already
+        bool emplace(Symbol name, std::shared_ptr<types::Type> type) {
+            if (!index.emplace(name, static_cast<std::uint32_t>(arguments.size())).second) {
+                return false;
+            }
+            arguments.emplace_back(name, std::move(type));
+            return true;
+        }
+
+        std::vector<Argument>::const_iterator begin() const { return std::begin(arguments); }
+        std::vector<Argument>::const_iterator end() const { return std::end(arguments); }
+        std::size_t size() const { return arguments.size(); }
+    };
+
+    // what the Resolver bound a name to
+    struct Resolved {
+        std::uint32_t slot;  // of the variable in the frame of its function
+        std::uint32_t field; // of the property in its class's struct, PROPERTY_ACCESS and SET of one
+    };
+
+    // 64 bytes, one cache line: the fields every kind uses plus one payload
+    // whose meaning depends on the kind. Whatever does not fit lives in the
+    // Arena and is pointed to, so nodes stay trivially destructible.
+    class Node {
+    public:
+        explicit Node(unsigned short k = 255, Node *op1 = nullptr, Node *op2 = nullptr, Node *op3 = nullptr)
+            : o1(op1), o2(op2), o3(op3), kind(k) {}
 
         enum node_type {
             VAR_ACCESS, CONST, ARG, ARRAY_ACCESS, FUNCTION_CALL,
@@ -66,35 +169,47 @@ namespace turnip2 {
             AND, OR, NOT,
             DO, WHILE, REPEAT,
             VAR_DEF, INIT, DELETE,
-            EMPTY, SEQ, EXPR,
+            EMPTY, BLOCK, EXPR,
             PRINTLN, INPUT,
             FUNCTION_DEFINE, CLASS_DEFINE
         };
 
-        unsigned short kind;
-        std::shared_ptr<class Node> o1, o2, o3;
-
         enum val_type {
             VOID, INTEGER, FLOATING, STRING, BOOL, USER
         };
         enum access_type {
             PRIVATE, PUBLIC, PROTECTED
         };
+        enum storage_type { // what the slot of a resolved variable holds
+            UNRESOLVED, SCALAR, STRING_BUFFER, STRING_POINTER, OBJECT, OBJECT_POINTER, ELEMENTS
+        };
 
-        int value_type = val_type::VOID;
-        std::string user_type = "";
-
-        int int_val = -1;
-        double float_val = 0.0;
-        std::string str_val = "";
+        Node *o1, *o2, *o3; // owned by the Arena the tree was parsed into
+        Location location;
 
-        std::unordered_map<std::string, std::pair<int, std::shared_ptr<Node>>> class_def_properties;
-        std::unordered_map<std::string, std::pair<int, std::shared_ptr<Node>>> class_def_methods;
-        std::unordered_map<std::string, std::shared_ptr<types::Type>> func_def_args;
-        std::vector<std::shared_ptr<Node>> func_call_args;
+        unsigned short kind;
+        unsigned char value_type = val_type::VOID;
+        unsigned char storage = storage_type::UNRESOLVED;
+        Symbol user_type;
+
+        Symbol var_name;
+        Symbol property_name;
+
+        union {
+            std::int64_t int_val = -1;     // CONST of INTEGER and BOOL
+            double float_val;              // CONST of FLOATING
+            std::string_view str_val;      // CONST of STRING, the text is in the Arena
+            NodeList func_call_args;       // FUNCTION_CALL, METHOD_CALL, FUNC_OBJ_METHOD_CALL, OBJECT_CONSTRUCT
+            ArgTypes *func_def_args;       // ARG_LIST
+            ClassBody *class_def;          // CLASS_DEFINE
+            NodeList statements;           // BLOCK, in source order
+            Resolved resolved;             // VAR_ACCESS, ARRAY_ACCESS, PROPERTY_ACCESS, FUNC_OBJ_PROPERTY_ACCESS, SET, VAR_DEF, INIT, INPUT, REPEAT
+            std::uint32_t frame_size;      // FUNCTION_DEFINE, slots of its arguments and locals
+        };
 
-        std::string var_name = "";
-        std::string property_name = "";
+        bool has_call_args() const {
+            return kind == FUNCTION_CALL || kind == METHOD_CALL || kind == FUNC_OBJ_METHOD_CALL || kind == OBJECT_CONSTRUCT;
+        }
     };
 }
 
@@ -0,0 +1,12 @@
+# Writes OUTPUT, a header defining TURNIP2_VERSION as a hash of SOURCES, the
+# files of the compiler. It is part of the key of the AST cache: a tree is
+# only reused by the compiler built from the very sources that parsed it,
+# whether they are committed or not.
+set(hashes "")
+foreach(source ${SOURCES})
+    file(SHA256 ${source} hash)
+    string(APPEND hashes "${source} ${hash}\n")
+endforeach()
+string(SHA256 version "${hashes}")
+
+file(WRITE ${OUTPUT} "#define TURNIP2_VERSION \"${version}\"\n")